@@ -0,0 +1,218 @@
+#include "batchsolver.h"
+
+namespace GIS {
+
+class BatchTask : public QRunnable
+{
+public:
+	BatchTask(BatchSolver *solver, int id, const BatchJob &job)
+		: m_solver(solver), m_id(id), m_job(job) {}
+	void run() { m_solver->run(m_id, m_job); }
+
+private:
+	BatchSolver *m_solver;
+	int m_id;
+	BatchJob m_job;
+};
+
+/*!
+\class BatchSolver
+*/
+BatchSolver::BatchSolver(int workers)
+	: m_submitted(0)
+	, m_finished(0)
+	, m_taken(0)
+	, m_lastFinished(0)
+{
+	m_pool.setMaxThreadCount(qMax(workers, 1));
+	// keep the workers between jobs
+	m_pool.setExpiryTimeout(-1);
+}
+
+BatchSolver::~BatchSolver()
+{
+	cancel();
+	m_pool.waitForDone();
+	clearGraphs();
+}
+
+int BatchSolver::submit(const BatchJob &job)
+{
+	m_mutex.lock();
+	if (m_submitted == 0) {
+		m_timer.start();
+	}
+	int id = m_submitted++;
+	m_mutex.unlock();
+	m_pool.start(new BatchTask(this, id, job));
+	return id;
+}
+
+bool BatchSolver::takeResult(BatchResult *result)
+{
+	QMutexLocker locker(&m_mutex);
+	while (m_results.isEmpty() && m_taken < m_submitted) {
+		m_resultReady.wait(&m_mutex);
+	}
+	if (m_results.isEmpty()) {
+		return false;
+	}
+	*result = m_results.takeFirst();
+	++m_taken;
+	return true;
+}
+
+void BatchSolver::waitForDone()
+{
+	m_pool.waitForDone();
+}
+
+void BatchSolver::cancel()
+{
+	m_cancel.cancel();
+}
+
+int BatchSolver::submitted() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_submitted;
+}
+
+int BatchSolver::finished() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_finished;
+}
+
+double BatchSolver::throughput() const
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_finished == 0) {
+		return 0;
+	}
+	return m_finished * 1000.0 / qMax(m_lastFinished, qint64(1));
+}
+
+void BatchSolver::clearGraphs()
+{
+	QMutexLocker locker(&m_mutex);
+	foreach (CachedGraph *cached, m_graphs) {
+		delete cached->graph;
+		delete cached;
+	}
+	m_graphs.clear();
+}
+
+// The first job on a file reads it while the others on the same file wait;
+// 0 if it cannot be read
+BatchSolver::CachedGraph *BatchSolver::loadedGraph(const QString &fileName)
+{
+	m_mutex.lock();
+	CachedGraph *&entry = m_graphs[fileName];
+	if (!entry) {
+		entry = new CachedGraph;
+	}
+	CachedGraph *cached = entry;
+	m_mutex.unlock();
+
+	QMutexLocker locker(&cached->mutex);
+	if (!cached->loaded) {
+		cached->loaded = true;
+		Graph *graph = new Graph;
+		if (graph->load(fileName)) {
+			cached->graph = graph;
+		} else {
+			delete graph;
+		}
+	}
+	return cached->graph ? cached : 0;
+}
+
+// Waits for the running solves on the graph; false if it is not connected
+bool BatchSolver::complete(CachedGraph *cached)
+{
+	QWriteLocker locker(&cached->lock);
+	if (!cached->completed) {
+		cached->completed = true;
+		cached->connected = cached->graph->isConnected();
+		if (cached->connected) {
+			cached->graph->findShortestPaths();
+		}
+	}
+	return cached->connected;
+}
+
+void BatchSolver::run(int id, const BatchJob &job)
+{
+	BatchResult result;
+	result.id = id;
+	result.fileName = job.fileName;
+	result.type = job.type;
+	if (m_cancel.isCanceled()) {
+		result.error = "Canceled";
+		finish(result);
+		return;
+	}
+	CachedGraph *cached = loadedGraph(job.fileName);
+	if (!cached) {
+		result.error = QString("Cannot read %1").arg(job.fileName);
+		finish(result);
+		return;
+	}
+	if (job.required.isEmpty() && !complete(cached)) {
+		result.error = QString("%1 is not connected").arg(job.fileName);
+		finish(result);
+		return;
+	}
+	QReadLocker locker(&cached->lock);
+	QList<Vertex *> required;
+	foreach (const QString &label, job.required) {
+		Vertex *v = cached->graph->vertex(label);
+		if (!v) {
+			result.error = QString("No vertex %1 in %2").arg(label, job.fileName);
+			finish(result);
+			return;
+		}
+		required.append(v);
+	}
+
+	ACSParameters::setThreadInstance(new ACSParameters(job.acsParameters));
+	ExactParameters::setThreadInstance(new ExactParameters(job.exactParameters));
+	QElapsedTimer timer;
+	timer.start();
+	Path *path;
+	{
+		StatsScope scope(&result.stats);
+		path = required.isEmpty()
+				? cached->graph->tspPath(job.type, 0, &m_cancel)
+				: cached->graph->tspPathThrough(required, job.type, 0, &m_cancel);
+	}
+	result.msec = timer.elapsed();
+	ACSParameters::setThreadInstance(0);
+	ExactParameters::setThreadInstance(0);
+
+	if (path) {
+		foreach (Vertex *v, path->vertices()) {
+			result.tour.append(v->label());
+		}
+		result.length = path->totalCost();
+		delete path;
+		if (job.lowerBound && required.isEmpty()) {
+			result.lowerBound = cached->graph->lowerBound(&m_cancel);
+		}
+	} else {
+		result.error = m_cancel.isCanceled() ? "Canceled" : "No tour found";
+	}
+	finish(result);
+}
+
+void BatchSolver::finish(const BatchResult &result)
+{
+	QMutexLocker locker(&m_mutex);
+	m_results.append(result);
+	++m_finished;
+	m_lastFinished = m_timer.elapsed();
+	m_resultReady.wakeAll();
+}
+
+} // namespace GIS
@@ -0,0 +1,129 @@
+#ifndef BATCHSOLVER_H
+#define BATCHSOLVER_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+#include "graph.h"
+#include "canceltoken.h"
+#include "singletons.h"
+
+namespace GIS {
+
+class BatchTask;
+
+// One solve of a BatchSolver
+struct BatchJob
+{
+	BatchJob()
+		: type(Graph::ACS)
+		, lowerBound(false)
+		, acsParameters(ACSParameters::instance())
+		, exactParameters(ExactParameters::instance()) {}
+
+	// Graph file, see Graph::load()
+	QString fileName;
+	Graph::TspType type;
+	// Labels of the vertices to visit (Graph::tspPathThrough()), all if empty
+	QStringList required;
+	// Also compute Graph::lowerBound() of a full tour, after the solve
+	bool lowerBound;
+	// Copies of the parameters in effect when the job was created
+	ACSParameters acsParameters;
+	ExactParameters exactParameters;
+};
+
+struct BatchResult
+{
+	BatchResult() : id(-1), type(Graph::ACS), length(-1), msec(0), lowerBound(-1) {}
+
+	bool isValid() const { return error.isEmpty(); }
+
+	int id;
+	QString fileName;
+	Graph::TspType type;
+	// Empty if a tour was found
+	QString error;
+	// Labels of the full path, the start repeated at the end
+	QStringList tour;
+	int length;
+	// Time of the solve, without reading the graph
+	int msec;
+	// -1 unless asked for and known
+	double lowerBound;
+	// Phases and counters of the solve
+	SolveStats stats;
+};
+
+// Solves many jobs on a fixed pool of worker threads. A graph file is read
+// by the first job that needs it and then shared by all the jobs on that
+// file; the first job touring all of its vertices also completes it
+// (Graph::findShortestPaths()), which jobs with required vertices do not
+// need. A worker installs the job's parameters as its thread's
+// ACSParameters and ExactParameters instances, so jobs with different
+// parameters may run at the same time. Results are queued in the order the
+// jobs finish.
+class BatchSolver
+{
+public:
+	BatchSolver(int workers = QThread::idealThreadCount());
+	// Cancels the jobs and waits for the running ones
+	~BatchSolver();
+
+	// Returns the id of the job; ids count from 0 in submission order
+	int submit(const BatchJob &job);
+	// Waits for the next finished job. Returns false once the results of
+	// all the submitted jobs have been taken.
+	bool takeResult(BatchResult *result);
+	void waitForDone();
+	// Running solves stop early, waiting jobs finish with an error
+	void cancel();
+
+	int submitted() const;
+	int finished() const;
+	// Finished jobs per second since the first submission
+	double throughput() const;
+	// Only while no job runs
+	void clearGraphs();
+
+	friend class BatchTask;
+
+private:
+	struct CachedGraph {
+		CachedGraph() : graph(0), loaded(false), completed(false), connected(false) {}
+		QMutex mutex;
+		// read by the solves, written by the completion
+		QReadWriteLock lock;
+		Graph *graph;
+		bool loaded;
+		bool completed;
+		bool connected;
+	};
+
+	CachedGraph *loadedGraph(const QString &fileName);
+	bool complete(CachedGraph *cached);
+	void run(int id, const BatchJob &job);
+	void finish(const BatchResult &result);
+
+	QThreadPool m_pool;
+	CancelToken m_cancel;
+	mutable QMutex m_mutex;
+	QWaitCondition m_resultReady;
+	QHash<QString, CachedGraph *> m_graphs;
+	QList<BatchResult> m_results;
+	int m_submitted;
+	int m_finished;
+	int m_taken;
+	QElapsedTimer m_timer;
+	qint64 m_lastFinished;
+};
+
+} // namespace GIS
+
+#endif // BATCHSOLVER_H
@@ -0,0 +1,523 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+#include <QtAlgorithms>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include "graph.h"
+#include "graphgenerator.h"
+#include "random.h"
+#include "singletons.h"
+
+// Benchmarks of the core library over a matrix of seeded generated graphs:
+// every benchmark runs on every family of graphs at every size, from the
+// smallest up, until a run takes longer than the budget. Results are
+// printed as JSON.
+
+namespace {
+
+const int sizes[] = { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000 };
+const int SizeCount = sizeof(sizes) / sizeof(sizes[0]);
+
+struct Family {
+	const char *name;
+	// edges to earlier vertices, see GraphGenerator::levelGraph(); 0 for
+	// a Euclidean graph
+	int level;
+};
+
+const Family families[] = {
+	{ "level-2", 2 },
+	{ "level-6", 6 },
+	{ "level-20", 20 },
+	{ "euclidean", 0 }
+};
+const int FamilyCount = sizeof(families) / sizeof(families[0]);
+
+enum BenchmarkId {
+	ReadFromFile,
+	IsConnected,
+	FindShortestPaths,
+	GetPath,
+	GetFullPath,
+	BruteForce,
+	AcsIteration,
+	BenchmarkCount
+};
+
+struct Benchmark {
+	const char *name;
+	// what the throughput counts
+	const char *unit;
+	int maxSize;
+};
+
+const Benchmark benchmarks[] = {
+	{ "readFromFile", "elements", 20000 },
+	{ "isConnected", "vertices", 20000 },
+	{ "findShortestPaths", "relaxations", 20000 },
+	{ "getPath", "queries", 20000 },
+	{ "getFullPath", "vertices", 20000 },
+	{ "bruteForce", "tours", 10 },
+	// the pheromone matrix is quadratic, ACS refuses bigger Euclidean graphs
+	{ "acsIteration", "iterations", GIS::DistanceMatrix::MaxDenseSize }
+};
+
+const int PathQueries = 1000;
+
+const char usage[] =
+	"Usage: gis-acs-bench [options]\n"
+	"Times the core library on seeded generated graphs of 10 to 20000\n"
+	"vertices and prints the results as JSON.\n"
+	"\n"
+	"  -r, --repeats N        measured runs of every case (5)\n"
+	"  -w, --warmup N         runs before them (1)\n"
+	"  -s, --seed N           seed of the graphs and queries (1)\n"
+	"  -b, --budget MSEC      a run longer than this ends the series of its\n"
+	"                         benchmark on its family of graphs (2000)\n"
+	"  -n, --max-vertices N   skip the bigger graphs (20000)\n"
+	"  -f, --filter A,B,...   only the benchmarks with these names\n"
+	"  -o, --output FILE      write the JSON there instead of stdout\n"
+	"  -h, --help\n"
+	"\n"
+	"Benchmarks: readFromFile, isConnected, findShortestPaths, getPath,\n"
+	"getFullPath, bruteForce, acsIteration.\n";
+
+void messageHandler(QtMsgType type, const char *message)
+{
+	// the solvers' debug output is part of what is measured, but not shown
+	if (type == QtDebugMsg) {
+		return;
+	}
+	std::fprintf(stderr, "%s\n", message);
+	if (type == QtFatalMsg) {
+		std::abort();
+	}
+}
+
+// Starts a new peak of the resident set where the system allows it
+void resetPeakMemory()
+{
+#if defined(Q_OS_LINUX)
+	QFile file("/proc/self/clear_refs");
+	if (file.open(QFile::WriteOnly)) {
+		file.write("5");
+	}
+#endif
+}
+
+// Peak resident set of the process in kB, -1 if unknown
+qint64 peakMemory()
+{
+#if defined(Q_OS_LINUX)
+	QFile file("/proc/self/status");
+	if (file.open(QFile::ReadOnly | QFile::Text)) {
+		foreach (const QByteArray &line, file.readAll().split('\n')) {
+			if (line.startsWith("VmHWM:")) {
+				return line.mid(6).trimmed().split(' ').first().toLongLong();
+			}
+		}
+	}
+	return -1;
+#elif defined(Q_OS_WIN)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize / 1024;
+	}
+	return -1;
+#elif defined(Q_OS_UNIX)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return -1;
+	}
+#if defined(Q_OS_MAC)
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+// One measured operation. prepare() and cleanUp() run around every run()
+// and are not timed.
+class Case
+{
+public:
+	virtual ~Case() {}
+	virtual void prepare() {}
+	virtual void run() = 0;
+	virtual void cleanUp() {}
+};
+
+class ReadCase : public Case
+{
+public:
+	ReadCase(const QString &fileName) : m_fileName(fileName), m_graph(0) {}
+	void prepare() { m_graph = new GIS::Graph; }
+	void run() { m_graph->readFromFile(m_fileName); }
+	void cleanUp() { delete m_graph; m_graph = 0; }
+
+private:
+	QString m_fileName;
+	GIS::Graph *m_graph;
+};
+
+class ConnectedCase : public Case
+{
+public:
+	ConnectedCase(const GIS::Graph *graph) : m_graph(graph) {}
+	void run() { m_graph->isConnected(); }
+
+private:
+	const GIS::Graph *m_graph;
+};
+
+// Completes a new copy of the graph every run and keeps the last one
+class ShortestPathsCase : public Case
+{
+public:
+	ShortestPathsCase(int vertices, int level, quint64 seed)
+		: m_vertices(vertices), m_level(level), m_seed(seed), m_graph(0) {}
+	~ShortestPathsCase() { delete m_graph; }
+	void prepare() {
+		delete m_graph;
+		m_graph = GIS::GraphGenerator::levelGraph(m_vertices, m_level, m_seed);
+	}
+	void run() { m_graph->findShortestPaths(); }
+	GIS::Graph *takeGraph() { GIS::Graph *graph = m_graph; m_graph = 0; return graph; }
+
+private:
+	int m_vertices;
+	int m_level;
+	quint64 m_seed;
+	GIS::Graph *m_graph;
+};
+
+class PathCase : public Case
+{
+public:
+	PathCase(GIS::Graph *graph, quint64 seed) : m_graph(graph) {
+		QList<GIS::Vertex *> vertices = graph->vertices();
+		GIS::Random random(seed);
+		for (int i = 0; i < PathQueries; ++i) {
+			m_from.append(vertices.at(random.nextInt(vertices.size())));
+			m_to.append(vertices.at(random.nextInt(vertices.size())));
+		}
+	}
+	void run() {
+		for (int i = 0; i < m_from.size(); ++i) {
+			delete m_graph->getPath(m_from.at(i), m_to.at(i));
+		}
+	}
+
+private:
+	GIS::Graph *m_graph;
+	QVector<GIS::Vertex *> m_from;
+	QVector<GIS::Vertex *> m_to;
+};
+
+// Expands a random tour of a complete graph
+class FullPathCase : public Case
+{
+public:
+	FullPathCase(GIS::Graph *graph, quint64 seed) : m_result(0) {
+		QList<GIS::Vertex *> vertices = graph->vertices();
+		GIS::Random random(seed);
+		for (int i = vertices.size() - 1; i > 0; --i) {
+			vertices.swap(i, random.nextInt(i + 1));
+		}
+		vertices.append(vertices.first());
+		m_path.setVertices(vertices);
+	}
+	void run() { m_result = m_path.getFullPath(); }
+	void cleanUp() { delete m_result; m_result = 0; }
+
+private:
+	GIS::Path m_path;
+	GIS::Path *m_result;
+};
+
+class BruteForceCase : public Case
+{
+public:
+	BruteForceCase(const GIS::Graph *graph) : m_graph(graph) {}
+	void run() { delete m_graph->tspPath(GIS::Graph::BruteForce); }
+
+private:
+	const GIS::Graph *m_graph;
+};
+
+// One iteration of a long ACS run
+class AcsCase : public Case
+{
+public:
+	AcsCase(GIS::Graph *graph, quint64 seed) : m_acs(graph, seed) { m_acs.init(); }
+	void run() { m_acs.iterate(1); }
+
+private:
+	GIS::ACS m_acs;
+};
+
+struct Measurement {
+	Measurement() : overBudget(false), peakMemory(-1) {}
+	// nanoseconds, sorted
+	QVector<qint64> times;
+	bool overBudget;
+	qint64 peakMemory;
+};
+
+// A run over the budget ends the measurement and is kept even if it was a
+// warm-up one
+Measurement measure(Case &c, int warmup, int repeats, qint64 budget)
+{
+	Measurement result;
+	resetPeakMemory();
+	for (int i = 0; i < warmup + repeats; ++i) {
+		c.prepare();
+		QElapsedTimer timer;
+		timer.start();
+		c.run();
+		qint64 time = timer.nsecsElapsed();
+		c.cleanUp();
+		result.overBudget = time > budget;
+		if (i >= warmup || result.overBudget) {
+			result.times.append(time);
+		}
+		if (result.overBudget) {
+			break;
+		}
+	}
+	qSort(result.times);
+	result.peakMemory = peakMemory();
+	return result;
+}
+
+// Nearest rank
+double percentile(const QVector<qint64> &sorted, int percent)
+{
+	int rank = (sorted.size() * percent + 99) / 100;
+	return sorted.at(qMax(rank, 1) - 1) / 1e6;
+}
+
+QString json(const Benchmark &benchmark, const Family &family, int vertices, int edges,
+			 double operations, const Measurement &measurement)
+{
+	double median = percentile(measurement.times, 50);
+	QStringList fields;
+	fields << QString("\"benchmark\":\"%1\"").arg(benchmark.name);
+	fields << QString("\"graph\":\"%1\"").arg(family.name);
+	fields << "\"vertices\":" + QString::number(vertices);
+	fields << "\"edges\":" + QString::number(edges);
+	fields << "\"samples\":" + QString::number(measurement.times.size());
+	fields << QString("\"unit\":\"%1\"").arg(benchmark.unit);
+	fields << "\"operations\":" + QString::number(operations, 'g', 12);
+	fields << "\"medianMs\":" + QString::number(median, 'f', 4);
+	fields << "\"p95Ms\":" + QString::number(percentile(measurement.times, 95), 'f', 4);
+	// operations per second at the median time
+	fields << "\"throughput\":" + QString::number(median > 0 ? operations * 1000 / median : 0, 'g', 6);
+	fields << "\"peakRssKb\":" + QString::number(measurement.peakMemory);
+	return "    {" + fields.join(", ") + "}";
+}
+
+int edgeCount(const GIS::Graph *graph)
+{
+	int count = 0;
+	foreach (GIS::Vertex *v, graph->vertices()) {
+		count += v->edges().size();
+	}
+	return count / 2;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	qInstallMsgHandler(messageHandler);
+
+	int repeats = 5;
+	int warmup = 1;
+	quint64 seed = 1;
+	int budget = 2000;
+	int maxVertices = 20000;
+	QStringList filter;
+	QString output;
+
+	QStringList arguments = app.arguments();
+	for (int i = 1; i < arguments.size(); ++i) {
+		QString option = arguments.at(i);
+		if (option == "-h" || option == "--help") {
+			std::fputs(usage, stdout);
+			return 0;
+		}
+		if (i + 1 >= arguments.size()) {
+			std::fprintf(stderr, "Unknown option or missing value: %s\n", qPrintable(option));
+			return 1;
+		}
+		QString value = arguments.at(++i);
+		bool ok = true;
+		if (option == "-r" || option == "--repeats") {
+			repeats = value.toInt(&ok);
+			ok = ok && repeats > 0;
+		} else if (option == "-w" || option == "--warmup") {
+			warmup = value.toInt(&ok);
+			ok = ok && warmup >= 0;
+		} else if (option == "-s" || option == "--seed") {
+			seed = value.toULongLong(&ok);
+		} else if (option == "-b" || option == "--budget") {
+			budget = value.toInt(&ok);
+			ok = ok && budget > 0;
+		} else if (option == "-n" || option == "--max-vertices") {
+			maxVertices = value.toInt(&ok);
+		} else if (option == "-f" || option == "--filter") {
+			filter = value.split(',', QString::SkipEmptyParts);
+		} else if (option == "-o" || option == "--output") {
+			output = value;
+		} else {
+			std::fprintf(stderr, "Unknown option %s\n", qPrintable(option));
+			return 1;
+		}
+		if (!ok) {
+			std::fprintf(stderr, "Bad value of %s: %s\n", qPrintable(option), qPrintable(value));
+			return 1;
+		}
+	}
+
+	bool enabled[BenchmarkCount];
+	for (int b = 0; b < BenchmarkCount; ++b) {
+		enabled[b] = filter.isEmpty() || filter.contains(benchmarks[b].name);
+	}
+	// ACS iterates for as long as it is asked to
+	ACSParameters::instance().setSeed(seed);
+	ACSParameters::instance().setIterations(INT_MAX);
+	ACSParameters::instance().setTimeBudget(0);
+	ACSParameters::instance().setStagnationLimit(0);
+	ACSParameters::instance().setTargetGap(-1);
+
+	qint64 budgetNs = qint64(budget) * 1000000;
+	QString fileName = QDir::temp().filePath(QString("gis-acs-bench-%1.xml").arg(QCoreApplication::applicationPid()));
+	QStringList results;
+	for (int f = 0; f < FamilyCount; ++f) {
+		const Family &family = families[f];
+		bool stopped[BenchmarkCount];
+		for (int b = 0; b < BenchmarkCount; ++b) {
+			stopped[b] = !enabled[b];
+		}
+		for (int s = 0; s < SizeCount && sizes[s] <= maxVertices; ++s) {
+			int n = sizes[s];
+			quint64 graphSeed = GIS::Random::deriveSeed(seed, n);
+			GIS::Graph *graph = family.level > 0
+					? GIS::GraphGenerator::levelGraph(n, family.level, graphSeed)
+					: GIS::GraphGenerator::euclideanGraph(n, 10000, graphSeed);
+			if (!graph) {
+				continue;
+			}
+			int edges = edgeCount(graph);
+			// the graph itself if Euclidean, else the result of
+			// findShortestPaths(), if it ran
+			GIS::Graph *complete = family.level > 0 ? 0 : graph;
+
+			for (int b = 0; b < BenchmarkCount; ++b) {
+				if (stopped[b] || n > benchmarks[b].maxSize) {
+					continue;
+				}
+				Case *c = 0;
+				double operations = 1;
+				switch (b) {
+				case ReadFromFile:
+					if (!graph->saveToFile(fileName)) {
+						break;
+					}
+					c = new ReadCase(fileName);
+					operations = n + edges;
+					break;
+				case IsConnected:
+					if (family.level > 0) {
+						c = new ConnectedCase(graph);
+						operations = n;
+					}
+					break;
+				case FindShortestPaths:
+					if (family.level > 0) {
+						c = new ShortestPathsCase(n, family.level, graphSeed);
+						operations = double(n) * n * n;
+					}
+					break;
+				case GetPath:
+					if (family.level > 0 && complete) {
+						c = new PathCase(complete, seed);
+						operations = PathQueries;
+					}
+					break;
+				case GetFullPath:
+					if (family.level > 0 && complete) {
+						c = new FullPathCase(complete, seed);
+						operations = n;
+					}
+					break;
+				case BruteForce:
+					if (complete) {
+						c = new BruteForceCase(complete);
+						for (int i = 2; i < n; ++i) {
+							operations *= i;
+						}
+					}
+					break;
+				case AcsIteration:
+					if (complete) {
+						c = new AcsCase(complete, seed);
+					}
+					break;
+				}
+				if (!c) {
+					continue;
+				}
+				Measurement measurement = measure(*c, warmup, repeats, budgetNs);
+				if (b == FindShortestPaths) {
+					complete = static_cast<ShortestPathsCase *>(c)->takeGraph();
+				}
+				delete c;
+				if (b == ReadFromFile) {
+					QFile::remove(fileName);
+				}
+				stopped[b] = measurement.overBudget;
+				results << json(benchmarks[b], family, n, edges, operations, measurement);
+				std::fprintf(stderr, "%s %s %d: %.3f ms%s\n", benchmarks[b].name, family.name, n,
+							 percentile(measurement.times, 50), stopped[b] ? ", over the budget" : "");
+			}
+			if (complete != graph) {
+				delete complete;
+			}
+			delete graph;
+		}
+	}
+
+	QString text = QString("{\n  \"seed\": %1,\n  \"repeats\": %2,\n  \"warmup\": %3,\n  \"budgetMs\": %4,\n"
+						   "  \"results\": [\n%5\n  ]\n}\n")
+			.arg(seed).arg(repeats).arg(warmup).arg(budget).arg(results.join(",\n"));
+	if (output.isEmpty()) {
+		std::fputs(text.toUtf8().constData(), stdout);
+		return 0;
+	}
+	QFile file(output);
+	if (!file.open(QFile::WriteOnly | QFile::Text | QFile::Truncate)) {
+		std::fprintf(stderr, "Cannot write %s\n", qPrintable(output));
+		return 1;
+	}
+	file.write(text.toUtf8());
+	return 0;
+}
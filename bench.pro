@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = gis-acs-bench
+CONFIG += console
+CONFIG -= app_bundle
+OBJECTS_DIR = obj/bench
+
+QT = core
+include(core.pri)
+win32: LIBS += -lpsapi
+
+SOURCES += \
+    bench.cpp
@@ -0,0 +1,253 @@
+#include "branchandbound.h"
+#include "distancematrix.h"
+#include "localsearch.h"
+#include "lowerbound.h"
+#include "canceltoken.h"
+
+#include <qmath.h>
+
+namespace GIS {
+
+// Tolerance of the real valued bounds, relative to the tour length
+static const double BoundEpsilon = 1e-9;
+
+/*!
+\class BranchAndBound
+*/
+BranchAndBound::BranchAndBound(const DistanceMatrix *distances)
+	: m_distances(distances)
+	, m_cancel(0)
+	, m_n(distances->size())
+	, m_penaltySum(0)
+	, m_bestLength(DistanceMatrix::Infinity)
+	, m_initialLength(DistanceMatrix::Infinity)
+	, m_rootBound(0)
+	, m_nodes(0)
+	, m_canceled(false)
+{
+}
+
+void BranchAndBound::setCancelToken(const CancelToken *cancel)
+{
+	m_cancel = cancel;
+}
+
+void BranchAndBound::setInitialTour(const QVector<int> &tour)
+{
+	m_initialTour = tour;
+}
+
+bool BranchAndBound::run()
+{
+	m_bestTour.clear();
+	m_bestLength = DistanceMatrix::Infinity;
+	m_rootBound = 0;
+	m_nodes = 0;
+	m_canceled = false;
+	if (m_n == 0) {
+		return true;
+	}
+
+	setInitialUpperBound();
+	m_initialLength = m_bestLength;
+	if (m_n < 4) {
+		// a single tour up to its direction
+		m_rootBound = m_bestLength;
+		return true;
+	}
+
+	computePenalties();
+	if (!canImprove(m_rootBound)) {
+		return true;
+	}
+
+	m_order = m_distances->neighbourLists(m_n - 1);
+	m_path.resize(m_n);
+	m_path[0] = 0;
+	m_visited.fill(false, m_n);
+	m_visited[0] = true;
+	m_unvisited.resize(m_n);
+	m_key.resize(m_n);
+	search(1, 0, 0);
+	return !m_canceled;
+}
+
+bool BranchAndBound::isPermutation(const QVector<int> &tour) const
+{
+	if (tour.size() != m_n) {
+		return false;
+	}
+	QVector<bool> seen(m_n, false);
+	foreach (int v, tour) {
+		if (v < 0 || v >= m_n || seen.at(v)) {
+			return false;
+		}
+		seen[v] = true;
+	}
+	return true;
+}
+
+// The better of the given tour and a nearest neighbour tour improved by the
+// local search
+void BranchAndBound::setInitialUpperBound()
+{
+	QVector<int> tour(m_n);
+	QVector<bool> visited(m_n, false);
+	tour[0] = 0;
+	visited[0] = true;
+	for (int i = 1; i < m_n; ++i) {
+		const int *row = m_distances->row(tour.at(i - 1));
+		int next = -1;
+		for (int v = 0; v < m_n; ++v) {
+			if (!visited.at(v) && (next < 0 || row[v] < row[next])) {
+				next = v;
+			}
+		}
+		tour[i] = next;
+		visited[next] = true;
+	}
+
+	LocalSearch localSearch(m_distances);
+	int length = localSearch.improve(tour, LocalSearch::TwoOptOrOpt);
+	if (isPermutation(m_initialTour)) {
+		int start = m_initialTour.indexOf(0);
+		QVector<int> initial = m_initialTour;
+		for (int i = 0; i < m_n; ++i) {
+			initial[i] = m_initialTour.at((start + i) % m_n);
+		}
+		int initialLength = m_distances->tourLength(initial);
+		if (initialLength <= length) {
+			tour = initial;
+			length = initialLength;
+		}
+	}
+
+	// a tour over a missing edge only bounds the search
+	bool valid = true;
+	for (int i = 0; i < m_n; ++i) {
+		if (m_distances->distance(tour.at(i), tour.at((i + 1) % m_n)) >= DistanceMatrix::Infinity) {
+			valid = false;
+		}
+	}
+	m_bestLength = length;
+	if (valid) {
+		m_bestTour = tour;
+	}
+}
+
+// Penalties of the Held-Karp bound (see LowerBound) and the reduced costs
+// under them
+void BranchAndBound::computePenalties()
+{
+	LowerBound lowerBound(m_distances);
+	lowerBound.setUpperBound(m_bestLength);
+	lowerBound.run();
+	m_pi = lowerBound.penalties();
+	m_rootBound = lowerBound.bound();
+
+	m_penaltySum = 0;
+	m_reduced.resize(m_n * m_n);
+	for (int i = 0; i < m_n; ++i) {
+		m_penaltySum += m_pi.at(i);
+		for (int j = 0; j < m_n; ++j) {
+			m_reduced[i * m_n + j] = m_distances->distance(i, j) + m_pi.at(i) + m_pi.at(j);
+		}
+	}
+}
+
+// Lower bound on the reduced length of a path from last through every
+// unvisited vertex back to 0
+double BranchAndBound::remainderBound(int last) const
+{
+	int k = 0;
+	for (int v = 1; v < m_n; ++v) {
+		if (!m_visited.at(v)) {
+			m_unvisited[k++] = v;
+		}
+	}
+	if (k == 0) {
+		return c(last, 0);
+	}
+
+	double toLast = c(last, m_unvisited.at(0));
+	double toStart = c(m_unvisited.at(0), 0);
+	for (int i = 1; i < k; ++i) {
+		toLast = qMin(toLast, c(last, m_unvisited.at(i)));
+		toStart = qMin(toStart, c(m_unvisited.at(i), 0));
+	}
+
+	// Prim over the unvisited vertices, the tree grows from the end of the
+	// array: entries [0, remaining) are still outside
+	double tree = 0;
+	int remaining = k - 1;
+	int u = m_unvisited.at(remaining);
+	for (int i = 0; i < remaining; ++i) {
+		m_key[i] = c(u, m_unvisited.at(i));
+	}
+	while (remaining > 0) {
+		int best = 0;
+		for (int i = 1; i < remaining; ++i) {
+			if (m_key.at(i) < m_key.at(best)) {
+				best = i;
+			}
+		}
+		tree += m_key.at(best);
+		u = m_unvisited.at(best);
+		--remaining;
+		m_unvisited[best] = m_unvisited.at(remaining);
+		m_key[best] = m_key.at(remaining);
+		const double *row = m_reduced.constData() + u * m_n;
+		for (int i = 0; i < remaining; ++i) {
+			m_key[i] = qMin(m_key.at(i), row[m_unvisited.at(i)]);
+		}
+	}
+	return toLast + tree + toStart;
+}
+
+// Whether a tour with the given lower bound on its length can be shorter than
+// the best one; lengths are integers, so it has to be at least one shorter
+bool BranchAndBound::canImprove(double bound) const
+{
+	return bound < m_bestLength - 1 + BoundEpsilon * m_bestLength + BoundEpsilon;
+}
+
+void BranchAndBound::search(int depth, int length, double reducedLength)
+{
+	++m_nodes;
+	if (m_cancel && m_cancel->isCanceled()) {
+		m_canceled = true;
+		return;
+	}
+
+	int last = m_path.at(depth - 1);
+	if (depth == m_n) {
+		int w = m_distances->distance(last, 0);
+		if (w < DistanceMatrix::Infinity && length + w < m_bestLength) {
+			m_bestLength = length + w;
+			m_bestTour = m_path;
+		}
+		return;
+	}
+	if (!canImprove(reducedLength + remainderBound(last) - 2 * m_penaltySum)) {
+		return;
+	}
+
+	const int *neighbours = m_order.constData() + last * (m_n - 1);
+	for (int i = 0; i < m_n - 1 && !m_canceled; ++i) {
+		int v = neighbours[i];
+		int w = m_distances->distance(last, v);
+		if (m_visited.at(v) || w >= DistanceMatrix::Infinity) {
+			continue;
+		}
+		// tours and their mirror images: vertex 1 before vertex 2
+		if (v == 2 && !m_visited.at(1)) {
+			continue;
+		}
+		m_visited[v] = true;
+		m_path[depth] = v;
+		search(depth + 1, length + w, reducedLength + c(last, v));
+		m_visited[v] = false;
+	}
+}
+
+} // namespace GIS
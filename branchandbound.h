@@ -0,0 +1,72 @@
+#ifndef BRANCHANDBOUND_H
+#define BRANCHANDBOUND_H
+
+#include <QVector>
+
+namespace GIS {
+
+class DistanceMatrix;
+class CancelToken;
+
+// Exact TSP by depth-first branch and bound over paths starting at vertex 0.
+// Bounds use the reduced costs d(i, j) + pi(i) + pi(j), with the penalties
+// pi of the Held-Karp 1-tree bound at the root (see LowerBound);
+// every tour is longer by exactly 2 sum(pi) under them. A partial path is cut
+// when its reduced length plus the bound of the rest (a spanning tree of the
+// unvisited vertices and the cheapest edges joining it to both ends) cannot
+// beat the best tour. Children are tried nearest first.
+class BranchAndBound
+{
+public:
+	BranchAndBound(const DistanceMatrix *distances);
+
+	void setCancelToken(const CancelToken *cancel);
+	// Upper bound to start from, e.g. the best tour of an ACS run. Without one
+	// a nearest neighbour tour improved by 2-opt/Or-opt is used.
+	void setInitialTour(const QVector<int> &tour);
+
+	// Returns false if canceled; the best tour is then not proven optimal
+	bool run();
+
+	// Sequence of vertex indices starting with 0, empty if there is no tour
+	const QVector<int> &bestTour() const { return m_bestTour; }
+	int bestLength() const { return m_bestLength; }
+	int initialLength() const { return m_initialLength; }
+	// Held-Karp bound at the root, a lower bound on the optimal length
+	double rootBound() const { return m_rootBound; }
+	// Search tree nodes expanded by the last run
+	qint64 nodes() const { return m_nodes; }
+
+private:
+	double c(int i, int j) const { return m_reduced.at(i * m_n + j); }
+	bool isPermutation(const QVector<int> &tour) const;
+	void setInitialUpperBound();
+	void computePenalties();
+	double remainderBound(int last) const;
+	bool canImprove(double bound) const;
+	void search(int depth, int length, double reducedLength);
+
+	const DistanceMatrix *m_distances;
+	const CancelToken *m_cancel;
+	int m_n;
+	QVector<double> m_pi;
+	QVector<double> m_reduced;
+	double m_penaltySum;
+	QVector<int> m_order;
+	QVector<int> m_path;
+	QVector<bool> m_visited;
+	// scratch space of the spanning tree bound
+	mutable QVector<int> m_unvisited;
+	mutable QVector<double> m_key;
+	QVector<int> m_initialTour;
+	QVector<int> m_bestTour;
+	int m_bestLength;
+	int m_initialLength;
+	double m_rootBound;
+	qint64 m_nodes;
+	bool m_canceled;
+};
+
+} // namespace GIS
+
+#endif // BRANCHANDBOUND_H
@@ -0,0 +1,255 @@
+#include "bruteforce.h"
+#include "distancematrix.h"
+#include "canceltoken.h"
+
+#include <QAtomicInt>
+#include <QtConcurrentMap>
+#include <algorithm>
+
+namespace GIS {
+
+// The cancel token is polled at the start of every task and once per
+// CancelCheckInterval + 1 search nodes
+static const qint64 CancelCheckInterval = 0xFFFFF;
+
+// Tours starting 0, first, second; first = -1 is the whole search
+struct BruteForceTask {
+	int first;
+	int second;
+	QVector<int> bestTour;
+	int bestLength;
+	qint64 tours;
+	bool canceled;
+};
+
+// Enumerates the tours of one task
+class PrefixSearch
+{
+public:
+	PrefixSearch(const DistanceMatrix *distances, const CancelToken *cancel, QAtomicInt *bound, BruteForceTask *task);
+
+	void run();
+
+private:
+	void search(int depth, int length);
+	void finishTour(int length);
+
+	const DistanceMatrix *m_distances;
+	const CancelToken *m_cancel;
+	QAtomicInt *m_bound;
+	BruteForceTask *m_task;
+	int m_n;
+	QVector<int> m_tour;
+	int *m_sequence;
+	qint64 m_nodes;
+	bool m_firstMirrorPlaced;
+};
+
+PrefixSearch::PrefixSearch(const DistanceMatrix *distances, const CancelToken *cancel, QAtomicInt *bound, BruteForceTask *task)
+	: m_distances(distances)
+	, m_cancel(cancel)
+	, m_bound(bound)
+	, m_task(task)
+	, m_n(distances->size())
+	, m_sequence(0)
+	, m_nodes(0)
+	, m_firstMirrorPlaced(false)
+{
+}
+
+void PrefixSearch::run()
+{
+	m_task->bestTour.clear();
+	m_task->bestLength = DistanceMatrix::Infinity;
+	m_task->tours = 0;
+	m_task->canceled = m_cancel && m_cancel->isCanceled();
+	if (m_task->canceled) {
+		return;
+	}
+
+	m_tour.resize(m_n);
+	for (int i = 0; i < m_n; ++i) {
+		m_tour[i] = i;
+	}
+	m_sequence = m_tour.data();
+	if (m_n == 1) {
+		finishTour(0);
+		return;
+	}
+	if (m_task->first < 0) {
+		search(1, 0);
+		return;
+	}
+
+	int first = m_task->first;
+	int second = m_task->second;
+	std::swap(m_sequence[1], m_sequence[first]);
+	std::swap(m_sequence[2], *std::find(m_sequence + 2, m_sequence + m_n, second));
+	m_firstMirrorPlaced = first == 1 || second == 1;
+	search(3, m_distances->distance(0, first) + m_distances->distance(first, second));
+}
+
+// m_tour[0..depth) is the partial tour of the given length, the rest are the
+// unvisited vertices. Every choice is swapped into place and back.
+void PrefixSearch::search(int depth, int length)
+{
+	int *tour = m_sequence;
+	const int *row = m_distances->row(tour[depth - 1]);
+
+	if ((++m_nodes & CancelCheckInterval) == 0 && m_cancel && m_cancel->isCanceled()) {
+		m_task->canceled = true;
+	}
+	// ties with the shared bound go on, the task order decides between them
+	if (m_task->canceled || length > int(*m_bound)) {
+		return;
+	}
+
+	if (depth == m_n - 1) {
+		// only for short tours, longer ones end in the unrolled level below
+		int w = row[tour[depth]];
+		if (w < DistanceMatrix::Infinity) {
+			finishTour(length + w);
+		}
+		return;
+	}
+	if (depth == m_n - 2) {
+		// the last two vertices in both orders; vertex 2 is never first of
+		// them before vertex 1 is placed, as vertex 1 is then the other one
+		int a = tour[depth];
+		int b = tour[depth + 1];
+		int ab = m_distances->row(a)[b];
+		if (ab >= DistanceMatrix::Infinity) {
+			return;
+		}
+		if (row[a] < DistanceMatrix::Infinity && (a != 2 || m_firstMirrorPlaced)) {
+			finishTour(length + row[a] + ab);
+		}
+		if (row[b] < DistanceMatrix::Infinity && (b != 2 || m_firstMirrorPlaced)) {
+			qSwap(tour[depth], tour[depth + 1]);
+			finishTour(length + row[b] + ab);
+			qSwap(tour[depth], tour[depth + 1]);
+		}
+		return;
+	}
+
+	for (int i = depth; i < m_n; ++i) {
+		int v = tour[i];
+		int w = row[v];
+		if (w >= DistanceMatrix::Infinity || (v == 2 && !m_firstMirrorPlaced)) {
+			continue;
+		}
+		qSwap(tour[depth], tour[i]);
+		if (v == 1) {
+			m_firstMirrorPlaced = true;
+		}
+		search(depth + 1, length + w);
+		if (v == 1) {
+			m_firstMirrorPlaced = false;
+		}
+		qSwap(tour[depth], tour[i]);
+		if (m_task->canceled) {
+			return;
+		}
+	}
+}
+
+void PrefixSearch::finishTour(int length)
+{
+	++m_task->tours;
+	if (m_n > 1) {
+		int w = m_distances->row(0)[m_sequence[m_n - 1]];
+		if (w >= DistanceMatrix::Infinity) {
+			return;
+		}
+		length += w;
+	}
+	if (length >= m_task->bestLength) {
+		return;
+	}
+	m_task->bestLength = length;
+	m_task->bestTour.resize(m_n);
+	std::copy(m_sequence, m_sequence + m_n, m_task->bestTour.begin());
+
+	int bound = *m_bound;
+	while (length < bound && !m_bound->testAndSetOrdered(bound, length)) {
+		bound = *m_bound;
+	}
+}
+
+struct RunBruteForceTask {
+	typedef void result_type;
+	RunBruteForceTask(const DistanceMatrix *distances, const CancelToken *cancel, QAtomicInt *bound)
+		: distances(distances), cancel(cancel), bound(bound) {}
+	void operator()(BruteForceTask &task) const {
+		PrefixSearch(distances, cancel, bound, &task).run();
+	}
+	const DistanceMatrix *distances;
+	const CancelToken *cancel;
+	QAtomicInt *bound;
+};
+
+/*!
+\class BruteForceSearch
+*/
+BruteForceSearch::BruteForceSearch(const DistanceMatrix *distances)
+	: m_distances(distances)
+	, m_cancel(0)
+	, m_n(distances->size())
+	, m_bestLength(DistanceMatrix::Infinity)
+	, m_tours(0)
+{
+}
+
+void BruteForceSearch::setCancelToken(const CancelToken *cancel)
+{
+	m_cancel = cancel;
+}
+
+bool BruteForceSearch::run()
+{
+	m_bestTour.clear();
+	m_bestLength = DistanceMatrix::Infinity;
+	m_tours = 0;
+	if (m_n == 0) {
+		return true;
+	}
+
+	// prefixes 0, a, b; a = 2 is the mirror image of a tour with vertex 2
+	// after vertex 1, b = 2 only follows a = 1
+	QVector<BruteForceTask> tasks;
+	BruteForceTask task;
+	if (m_n < 5) {
+		task.first = -1;
+		task.second = -1;
+		tasks.append(task);
+	} else {
+		for (int a = 1; a < m_n; ++a) {
+			for (int b = 1; b < m_n; ++b) {
+				if (a == b || a == 2 || (b == 2 && a != 1)
+						|| m_distances->distance(0, a) >= DistanceMatrix::Infinity
+						|| m_distances->distance(a, b) >= DistanceMatrix::Infinity) {
+					continue;
+				}
+				task.first = a;
+				task.second = b;
+				tasks.append(task);
+			}
+		}
+	}
+
+	QAtomicInt bound(DistanceMatrix::Infinity);
+	QtConcurrent::blockingMap(tasks, RunBruteForceTask(m_distances, m_cancel, &bound));
+
+	bool canceled = false;
+	foreach (const BruteForceTask &t, tasks) {
+		m_tours += t.tours;
+		canceled = canceled || t.canceled;
+		if (!t.bestTour.isEmpty() && t.bestLength < m_bestLength) {
+			m_bestLength = t.bestLength;
+			m_bestTour = t.bestTour;
+		}
+	}
+	return !canceled;
+}
+
+} // namespace GIS
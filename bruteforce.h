@@ -0,0 +1,51 @@
+#ifndef BRUTEFORCE_H
+#define BRUTEFORCE_H
+
+#include <QVector>
+
+namespace GIS {
+
+class DistanceMatrix;
+class CancelToken;
+
+// Exhaustive search over the closed tours of a DistanceMatrix. Permutations
+// are enumerated in place by depth-first swapping with the length of the
+// partial tour carried along, so memory is O(n) per thread. Vertex 0 is the
+// fixed start and a tour is skipped when its mirror image is also enumerated
+// (vertex 2 may only be placed after vertex 1), which leaves (n - 1)! / 2
+// tours. Missing edges (DistanceMatrix::Infinity) are never walked.
+//
+// The tours are split by the two vertices following the start into tasks run
+// on the global thread pool. Every task keeps its own best tour and shares
+// the best length found so far through an atomic, partial tours longer than
+// it are cut. Ties go to the first task, so the tour does not depend on the
+// scheduling.
+class BruteForceSearch
+{
+public:
+	BruteForceSearch(const DistanceMatrix *distances);
+
+	void setCancelToken(const CancelToken *cancel);
+
+	// Returns false if canceled; the best tour is then only the best of the
+	// tours seen so far
+	bool run();
+
+	// Sequence of vertex indices starting with 0, empty if there is no tour
+	const QVector<int> &bestTour() const { return m_bestTour; }
+	int bestLength() const { return m_bestLength; }
+	// Number of complete tours evaluated by the last run
+	qint64 tours() const { return m_tours; }
+
+private:
+	const DistanceMatrix *m_distances;
+	const CancelToken *m_cancel;
+	int m_n;
+	QVector<int> m_bestTour;
+	int m_bestLength;
+	qint64 m_tours;
+};
+
+} // namespace GIS
+
+#endif // BRUTEFORCE_H
@@ -0,0 +1,26 @@
+#ifndef CANCELTOKEN_H
+#define CANCELTOKEN_H
+
+#include <QAtomicInt>
+
+namespace GIS {
+
+// Set from any thread to ask a running solver to stop. Solvers poll it in
+// their main loops and return what they have found so far (ACS) or nothing
+// (brute force).
+class CancelToken
+{
+public:
+	CancelToken() : m_canceled(0) {}
+
+	void cancel() { m_canceled.fetchAndStoreRelease(1); }
+	void reset() { m_canceled.fetchAndStoreRelease(0); }
+	bool isCanceled() const { return (int)m_canceled != 0; }
+
+private:
+	QAtomicInt m_canceled;
+};
+
+} // namespace GIS
+
+#endif // CANCELTOKEN_H
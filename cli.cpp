@@ -0,0 +1,379 @@
+#include <QCoreApplication>
+#include <QMap>
+#include <QStringList>
+#include <QThread>
+#include <cstdio>
+#include <cstdlib>
+
+#include "batchsolver.h"
+#include "lowerbound.h"
+#include "singletons.h"
+
+// Headless solver: solves graph files with the core library and prints one
+// JSON object per file on standard output.
+
+namespace {
+
+struct Method {
+	const char *name;
+	GIS::Graph::TspType type;
+};
+
+const Method methods[] = {
+	{ "acs", GIS::Graph::ACS },
+	{ "bf", GIS::Graph::BruteForce },
+	{ "bb", GIS::Graph::BranchAndBound },
+	{ "hk", GIS::Graph::HeldKarp },
+	{ "nn", GIS::Graph::NearestNeighbour },
+	{ "greedy", GIS::Graph::GreedyEdge },
+	{ "farthest", GIS::Graph::FarthestInsertion },
+	{ "cheapest", GIS::Graph::CheapestInsertion },
+	{ "sfc", GIS::Graph::SpaceFillingCurve },
+	{ "ils", GIS::Graph::IteratedLocalSearch }
+};
+const int MethodCount = sizeof(methods) / sizeof(methods[0]);
+
+// In the order of GIS::LocalSearch::Type, GIS::ColonyParameters::Variant and
+// GIS::MultiColonyACS::Topology
+const char *const localSearchNames[] = { "none", "2opt", "oropt", "2opt+oropt", 0 };
+const char *const variantNames[] = { "acs", "mmas", "rank", 0 };
+const char *const topologyNames[] = { "ring", "full", 0 };
+
+const char usage[] =
+	"Usage: gis-acs-cli [options] file...\n"
+	"Solves the TSP on every graph file (XML or TSPLIB) and prints one JSON\n"
+	"object per file on standard output, in the order of the files.\n"
+	"\n"
+	"  -m, --method NAME       acs (default), bf, bb, hk, nn, greedy, farthest,\n"
+	"                          cheapest, sfc or ils\n"
+	"  -s, --seed N            master seed of the randomised methods\n"
+	"  -r, --required A,B,...  visit only these vertices\n"
+	"  -j, --jobs N            files solved at the same time\n"
+	"  -b, --lower-bound       also print the Held-Karp lower bound and the gap\n"
+	"  -v, --verbose           print the log of the solvers on stderr\n"
+	"  --log FILE              append the log to a file instead\n"
+	"  --stats                 also print the timed phases and counters\n"
+	"  --trace N               also print up to N samples of the convergence\n"
+	"                          of an ACS run\n"
+	"  -h, --help\n"
+	"\n"
+	"ACS:\n"
+	"  --iterations N  --ants N  --time MSEC  --stagnation N  --target-gap PERCENT\n"
+	"  --beta X  --phi X  --q0 X  --alpha X  --tau0 N|auto\n"
+	"  --variant acs|mmas|rank  --rank-weight N\n"
+	"  --local-search none|2opt|oropt|2opt+oropt  --local-search-all\n"
+	"  --colonies N  --migration N  --topology ring|full\n"
+	"\n"
+	"Exact methods and ILS:\n"
+	"  --memory MB  --ils-time SEC\n"
+	"\n"
+	"Exit status: 0 if every file was solved, 1 for bad arguments, 2 otherwise.\n";
+
+bool verbose = false;
+bool showStats = false;
+
+void messageHandler(QtMsgType type, const char *message)
+{
+	if (type == QtDebugMsg && !verbose) {
+		return;
+	}
+	std::fprintf(stderr, "%s\n", message);
+	if (type == QtFatalMsg) {
+		std::abort();
+	}
+}
+
+int indexOf(const char *const names[], const QString &name)
+{
+	for (int i = 0; names[i]; ++i) {
+		if (name == names[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+QString jsonString(const QString &string)
+{
+	QString result("\"");
+	for (int i = 0; i < string.size(); ++i) {
+		QChar c = string.at(i);
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (c == '\n') {
+			result += "\\n";
+		} else if (c == '\t') {
+			result += "\\t";
+		} else if (c.unicode() < 0x20) {
+			result += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+		} else {
+			result += c;
+		}
+	}
+	result += '"';
+	return result;
+}
+
+QString json(const GIS::BatchResult &result, const char *method, quint64 seed)
+{
+	QStringList fields;
+	fields << "\"file\":" + jsonString(result.fileName);
+	fields << "\"method\":" + jsonString(method);
+	fields << "\"seed\":" + QString::number(seed);
+	if (!result.isValid()) {
+		fields << "\"error\":" + jsonString(result.error);
+		return "{" + fields.join(",") + "}";
+	}
+	fields << "\"length\":" + QString::number(result.length);
+	fields << "\"msec\":" + QString::number(result.msec);
+	if (result.lowerBound > 0) {
+		fields << "\"lowerBound\":" + QString::number(result.lowerBound, 'f', 2);
+		fields << "\"gap\":" + QString::number(GIS::LowerBound::gap(result.length, result.lowerBound), 'f', 3);
+	}
+	QStringList tour;
+	foreach (const QString &label, result.tour) {
+		tour << jsonString(label);
+	}
+	fields << "\"tour\":[" + tour.join(",") + "]";
+	if (showStats) {
+		const GIS::SolveStats &stats = result.stats;
+		QStringList entries;
+		for (int i = 0; i < GIS::SolveStats::PhaseCount; ++i) {
+			if (stats.calls[i]) {
+				entries << QString("\"%1Ms\":%2").arg(GIS::SolveStats::phaseName(i)).arg(stats.nsecs[i] / 1e6, 0, 'f', 3);
+				entries << QString("\"%1Calls\":%2").arg(GIS::SolveStats::phaseName(i)).arg(stats.calls[i]);
+			}
+		}
+		for (int i = 0; i < GIS::SolveStats::CounterCount; ++i) {
+			entries << QString("\"%1\":%2").arg(GIS::SolveStats::counterName(i)).arg(stats.counters[i]);
+		}
+		fields << "\"stats\":{" + entries.join(",") + "}";
+	}
+	if (!result.stats.trace.isEmpty()) {
+		fields << "\"trace\":" + result.stats.trace.toJson();
+	}
+	return "{" + fields.join(",") + "}";
+}
+
+void print(const QString &line)
+{
+	std::fputs(line.toUtf8().constData(), stdout);
+	std::fputc('\n', stdout);
+	std::fflush(stdout);
+}
+
+// Walks the arguments; the first wrong one is reported on stderr and
+// clears ok()
+class Arguments
+{
+public:
+	Arguments(const QStringList &arguments) : m_arguments(arguments), m_index(1), m_ok(true) {}
+
+	bool atEnd() const { return m_index >= m_arguments.size(); }
+	QString next() { return m_arguments.at(m_index++); }
+	bool ok() const { return m_ok; }
+
+	QString value(const QString &option) {
+		if (atEnd()) {
+			return fail(QString("%1 needs a value").arg(option));
+		}
+		return next();
+	}
+	int toInt(const QString &option, int minimum) {
+		QString text = value(option);
+		bool ok = false;
+		int number = text.toInt(&ok);
+		if (m_ok && (!ok || number < minimum)) {
+			fail(QString("Bad value of %1: %2").arg(option).arg(text));
+		}
+		return number;
+	}
+	double toDouble(const QString &option) {
+		QString text = value(option);
+		bool ok = false;
+		double number = text.toDouble(&ok);
+		if (m_ok && !ok) {
+			fail(QString("Bad value of %1: %2").arg(option).arg(text));
+		}
+		return number;
+	}
+	int toIndex(const QString &option, const char *const names[]) {
+		QString text = value(option);
+		int index = indexOf(names, text);
+		if (m_ok && index < 0) {
+			fail(QString("Bad value of %1: %2").arg(option).arg(text));
+		}
+		return index;
+	}
+	QString fail(const QString &message) {
+		if (m_ok) {
+			std::fprintf(stderr, "%s\n", qPrintable(message));
+		}
+		m_ok = false;
+		return QString();
+	}
+
+private:
+	QStringList m_arguments;
+	int m_index;
+	bool m_ok;
+};
+
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	qInstallMsgHandler(messageHandler);
+
+	ACSParameters acs;
+	ExactParameters exact;
+	int method = 0;
+	int jobs = QThread::idealThreadCount();
+	bool lowerBound = false;
+	QString logFile;
+	QStringList required;
+	QStringList files;
+
+	Arguments args(app.arguments());
+	while (!args.atEnd() && args.ok()) {
+		QString option = args.next();
+		if (option == "-h" || option == "--help") {
+			std::fputs(usage, stdout);
+			return 0;
+		} else if (option == "-m" || option == "--method") {
+			QString name = args.value(option);
+			method = -1;
+			for (int i = 0; i < MethodCount; ++i) {
+				if (name == methods[i].name) {
+					method = i;
+				}
+			}
+			if (method < 0) {
+				args.fail(QString("Unknown method %1").arg(name));
+			}
+		} else if (option == "-s" || option == "--seed") {
+			QString text = args.value(option);
+			bool ok = false;
+			acs.setSeed(text.toULongLong(&ok));
+			if (!ok) {
+				args.fail(QString("Bad value of %1: %2").arg(option).arg(text));
+			}
+		} else if (option == "-r" || option == "--required") {
+			required = args.value(option).split(',', QString::SkipEmptyParts);
+		} else if (option == "-j" || option == "--jobs") {
+			jobs = args.toInt(option, 1);
+		} else if (option == "-b" || option == "--lower-bound") {
+			lowerBound = true;
+		} else if (option == "-v" || option == "--verbose") {
+			verbose = true;
+		} else if (option == "--log") {
+			logFile = args.value(option);
+		} else if (option == "--trace") {
+			acs.setTraceCapacity(args.toInt(option, 0));
+		} else if (option == "--stats") {
+			showStats = true;
+		} else if (option == "--iterations") {
+			acs.setIterations(args.toInt(option, 0));
+		} else if (option == "--ants") {
+			acs.setAnts(args.toInt(option, 1));
+		} else if (option == "--time") {
+			acs.setTimeBudget(args.toInt(option, 0));
+		} else if (option == "--stagnation") {
+			acs.setStagnationLimit(args.toInt(option, 0));
+		} else if (option == "--target-gap") {
+			acs.setTargetGap(args.toDouble(option));
+		} else if (option == "--beta") {
+			acs.setBeta(args.toDouble(option));
+		} else if (option == "--phi") {
+			acs.setPhi(args.toDouble(option));
+		} else if (option == "--q0") {
+			acs.setQ0(args.toDouble(option));
+		} else if (option == "--alpha") {
+			acs.setAlpha(args.toDouble(option));
+		} else if (option == "--tau0") {
+			QString text = args.value(option);
+			if (text == "auto") {
+				acs.setAutoPheromoneZero(true);
+			} else {
+				bool ok = false;
+				acs.setPheromoneZero(text.toInt(&ok));
+				acs.setAutoPheromoneZero(false);
+				if (!ok) {
+					args.fail(QString("Bad value of %1: %2").arg(option).arg(text));
+				}
+			}
+		} else if (option == "--variant") {
+			acs.setVariant(args.toIndex(option, variantNames));
+		} else if (option == "--rank-weight") {
+			acs.setRankWeight(args.toInt(option, 2));
+		} else if (option == "--local-search") {
+			acs.setLocalSearch(args.toIndex(option, localSearchNames));
+		} else if (option == "--local-search-all") {
+			acs.setLocalSearchAllAnts(true);
+		} else if (option == "--colonies") {
+			acs.setColonies(args.toInt(option, 1));
+		} else if (option == "--migration") {
+			acs.setMigrationInterval(args.toInt(option, 1));
+		} else if (option == "--topology") {
+			acs.setMigrationTopology(args.toIndex(option, topologyNames));
+		} else if (option == "--memory") {
+			exact.setMemoryBudget(args.toInt(option, 1));
+		} else if (option == "--ils-time") {
+			exact.setImprovementTimeLimit(args.toInt(option, 0));
+		} else if (option.startsWith('-') && option != "-") {
+			args.fail(QString("Unknown option %1").arg(option));
+		} else {
+			files << option;
+		}
+	}
+	if (!args.ok()) {
+		return 1;
+	}
+	if (files.isEmpty()) {
+		std::fputs(usage, stderr);
+		return 1;
+	}
+
+	GIS::Log &log = GIS::Log::instance();
+	log.setLevel(verbose ? GIS::Log::Debug : GIS::Log::Warning);
+	if (logFile.isEmpty()) {
+		log.addSink(new GIS::StderrSink);
+	} else {
+		GIS::FileSink *sink = new GIS::FileSink(logFile);
+		if (!sink->isOpen()) {
+			std::fprintf(stderr, "Cannot open %s\n", qPrintable(logFile));
+			delete sink;
+			return 1;
+		}
+		log.addSink(sink);
+	}
+
+	GIS::BatchSolver solver(jobs);
+	foreach (const QString &file, files) {
+		GIS::BatchJob job;
+		job.fileName = file;
+		job.type = methods[method].type;
+		job.required = required;
+		job.lowerBound = lowerBound;
+		job.acsParameters = acs;
+		job.exactParameters = exact;
+		solver.submit(job);
+	}
+
+	// printed in the order of the files, as soon as the earlier ones are
+	QMap<int, GIS::BatchResult> pending;
+	int nextId = 0;
+	bool solved = true;
+	GIS::BatchResult result;
+	while (solver.takeResult(&result)) {
+		solved = solved && result.isValid();
+		pending.insert(result.id, result);
+		while (pending.contains(nextId)) {
+			print(json(pending.take(nextId), methods[method].name, acs.seed()));
+			++nextId;
+		}
+	}
+	return solved ? 0 : 2;
+}
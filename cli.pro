@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = gis-acs-cli
+CONFIG += console
+CONFIG -= app_bundle
+OBJECTS_DIR = obj/cli
+
+QT = core
+include(core.pri)
+
+SOURCES += \
+    cli.cpp
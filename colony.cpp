@@ -0,0 +1,118 @@
+#include "colony.h"
+#include "singletons.h"
+
+namespace GIS {
+
+/*!
+\class ColonyParameters
+*/
+ColonyParameters ColonyParameters::fromSettings(const ACSParameters &settings)
+{
+	ColonyParameters params;
+	params.variant = (Variant)settings.variant();
+	params.ants = settings.ants();
+	params.beta = settings.beta();
+	params.phi = settings.phi();
+	params.pheromoneZero = settings.pheromoneZero();
+	params.q0 = settings.q0();
+	params.evaporation = settings.alpha();
+	params.rankWeight = settings.rankWeight();
+	return params;
+}
+
+/*!
+\class ACSData
+*/
+void ACSData::setDistances(const DistanceMatrix *d, double pheromoneZero)
+{
+	m_distances = d;
+	N = d->size();
+	m_pheromones.fill(pheromoneZero, N * N);
+	m_heuristic.fill(0, N * N);
+}
+
+void ACSData::evaporate(double factor)
+{
+	double *p = m_pheromones.data();
+	for (int i = 0; i < N * N; ++i) {
+		p[i] *= factor;
+	}
+	GIS_COUNT(m_stats, PheromoneWrites, qint64(N) * N);
+}
+
+void ACSData::deposit(Tour *t, double amount)
+{
+	const int *seq = t->sequence().constData();
+	int size = t->size();
+	for (int i = 0; i < size; ++i) {
+		int from = seq[i];
+		int to = seq[i + 1 == size ? 0 : i + 1];
+		setPheromone(from, to, pheromone(from, to) + amount);
+	}
+}
+
+void ACSData::clamp(double min, double max)
+{
+	double *p = m_pheromones.data();
+	for (int i = 0; i < N * N; ++i) {
+		p[i] = qBound(min, p[i], max);
+	}
+	GIS_COUNT(m_stats, PheromoneWrites, qint64(N) * N);
+}
+
+/*!
+\class Ant
+*/
+Ant::Ant(ACSData *acsData, const Random &random)
+	: m_tour(acsData->distances())
+	, m_ACSData(acsData)
+	, m_random(random)
+{
+	int n = acsData->N;
+	m_home = m_random.nextInt(n);
+	m_unvisited.resize(n);
+	m_position.resize(n);
+	m_desirability.resize(n);
+	reset();
+}
+
+void Ant::visit(int v)
+{
+	m_tour.addStep(v);
+	m_current = v;
+
+	int last = m_unvisited[--m_unvisitedCount];
+	int pos = m_position[v];
+	m_unvisited[pos] = last;
+	m_position[last] = pos;
+}
+
+void Ant::reset()
+{
+	int n = m_ACSData->N;
+	m_unvisitedCount = 0;
+	for (int v = 0; v < n; ++v) {
+		if (v != m_home) {
+			m_position[v] = m_unvisitedCount;
+			m_unvisited[m_unvisitedCount++] = v;
+		}
+	}
+	m_current = m_home;
+	m_previous = m_home;
+	m_tour.reset(m_home);
+}
+
+// Picks the instantiation for the variant
+AntColony *createColony(const DistanceMatrix *distances, const ColonyParameters &params, quint64 seed)
+{
+	switch (params.variant) {
+	case ColonyParameters::MaxMinAntSystem:
+		return new Colony<RandomProportional, NoLocalUpdate, MaxMinGlobalUpdate>(distances, params, seed);
+	case ColonyParameters::RankBasedAntSystem:
+		return new Colony<RandomProportional, NoLocalUpdate, RankBasedGlobalUpdate>(distances, params, seed);
+	default:
+		return new Colony<PseudoRandomProportional, ACSLocalUpdate, ACSGlobalUpdate>(distances, params, seed);
+	}
+}
+
+} // namespace GIS
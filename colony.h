@@ -0,0 +1,420 @@
+#ifndef COLONY_H
+#define COLONY_H
+
+#include <QList>
+#include <QVector>
+#include <QtAlgorithms>
+#include <qmath.h>
+
+#include "graph.h"
+#include "random.h"
+#include "desirability.h"
+#include "instrumentation.h"
+
+class ACSParameters;
+
+namespace GIS {
+
+// Snapshot of the ACSParameters a colony runs with, taken once per run so
+// that the construction loop does not go through the singleton
+struct ColonyParameters
+{
+	enum Variant {
+		AntColonySystem,
+		MaxMinAntSystem,
+		RankBasedAntSystem
+	};
+
+	static ColonyParameters fromSettings(const ACSParameters &settings);
+
+	Variant variant;
+	int ants;
+	double beta;
+	double phi;
+	double pheromoneZero;
+	double q0;
+	// ALPHA of the ACS global update, rho of MMAS and rank-based AS
+	double evaporation;
+	// Rank-based AS: the w - 1 best ants and the best-so-far tour deposit
+	int rankWeight;
+};
+
+// Pheromone and heuristic values as flat N x N arrays indexed like the
+// DistanceMatrix of the colony; both are kept symmetric
+class ACSData
+{
+public:
+	ACSData() : N(0), m_distances(0), m_stats(0) {}
+
+	void setDistances(const DistanceMatrix *d, double pheromoneZero);
+	// Counts the pheromone writes, 0 does not
+	void setStats(SolveStats *stats) { m_stats = stats; }
+
+	const DistanceMatrix *distances() const { return m_distances; }
+
+	double pheromone(int i, int j) const { return m_pheromones[i * N + j]; }
+	void setPheromone(int i, int j, double pheromone)
+	{
+		m_pheromones[i * N + j] = pheromone;
+		m_pheromones[j * N + i] = pheromone;
+		GIS_COUNT(m_stats, PheromoneWrites, 2);
+	}
+
+	const double *pheromoneRow(int i) const { return m_pheromones.constData() + i * N; }
+	const double *heuristicRow(int i) const { return m_heuristic.constData() + i * N; }
+	double *heuristicData() { return m_heuristic.data(); }
+
+	void evaporate(double factor);
+	// Adds amount to the pheromone of every edge of the tour
+	void deposit(Tour *t, double amount);
+	void clamp(double min, double max);
+
+	int N;
+
+private:
+	QVector<double> m_pheromones;
+	QVector<double> m_heuristic;
+	const DistanceMatrix *m_distances;
+	SolveStats *m_stats;
+};
+
+class Ant
+{
+public:
+	Ant(ACSData *acsData, const Random &random);
+
+	Tour *tour() { return &m_tour; }
+	int tourLength() { return m_tour.length(); }
+
+	template <class Transition>
+	void step(const Transition &rule);
+	template <class LocalUpdate>
+	void localUpdate(const LocalUpdate &rule) { rule.update(*m_ACSData, m_previous, m_current); }
+
+	void reset();
+
+private:
+	void visit(int v);
+
+	int m_home;
+	int m_current;
+	int m_previous;
+	QVector<int> m_unvisited;
+	QVector<int> m_position;
+	int m_unvisitedCount;
+	QVector<double> m_desirability;
+	Tour m_tour;
+	ACSData *m_ACSData;
+	Random m_random;
+};
+
+// Unvisited vertices are the first m_unvisitedCount entries of m_unvisited,
+// m_position maps a vertex to its entry so it is removed by swapping with
+// the last one
+template <class Transition>
+void Ant::step(const Transition &rule)
+{
+	m_previous = m_current;
+	if (m_unvisitedCount > 0) {
+		int index = rule.choose(m_ACSData->pheromoneRow(m_current), m_ACSData->heuristicRow(m_current),
+								m_unvisited.constData(), m_unvisitedCount, m_desirability.data(), m_random);
+		visit(m_unvisited[index]);
+	} else {
+		m_tour.close();
+		m_current = m_home;
+	}
+}
+
+// Transition rules. choose() returns the position of the next vertex in the
+// candidate list; desirability is scratch space of the same size.
+
+// Random proportional rule of Ant System: roulette over tau * eta, the
+// wheel is a prefix sum searched by bisection
+class RandomProportional
+{
+public:
+	RandomProportional(const ColonyParameters &params) : m_beta(params.beta) {}
+
+	// eta = (1/d)^beta, computed once per edge when the colony is created
+	double heuristic(double inverseDistance) const { return qPow(inverseDistance, m_beta); }
+
+	int choose(const double *tau, const double *eta, const int *candidates, int n, double *desirability, Random &random) const
+	{
+		Desirability::product(tau, eta, candidates, n, desirability);
+		return roulette(desirability, n, random);
+	}
+
+protected:
+	static int roulette(double *desirability, int n, Random &random)
+	{
+		double total = Desirability::prefixSum(desirability, n);
+		double rand = random.nextDouble() * total;
+		// last slot also catches rounding of the running sum
+		return qUpperBound(desirability, desirability + n - 1, rand) - desirability;
+	}
+
+private:
+	double m_beta;
+};
+
+// Pseudo-random proportional rule of ACS: with probability q0 the most
+// desirable vertex, otherwise the random proportional rule
+class PseudoRandomProportional : public RandomProportional
+{
+public:
+	PseudoRandomProportional(const ColonyParameters &params) : RandomProportional(params), m_q0(params.q0) {}
+
+	int choose(const double *tau, const double *eta, const int *candidates, int n, double *desirability, Random &random) const
+	{
+		Desirability::product(tau, eta, candidates, n, desirability);
+		if (m_q0 > 0 && random.nextDouble() < m_q0) {
+			return Desirability::argMax(desirability, n);
+		}
+		return roulette(desirability, n, random);
+	}
+
+private:
+	double m_q0;
+};
+
+// Local update rules, applied to the edge every ant just walked
+
+class NoLocalUpdate
+{
+public:
+	NoLocalUpdate(const ColonyParameters &) {}
+	void update(ACSData &, int, int) const {}
+};
+
+// ACS: tau = (1 - phi) tau + phi tau0
+class ACSLocalUpdate
+{
+public:
+	ACSLocalUpdate(const ColonyParameters &params) : m_phi(params.phi), m_pheromoneZero(params.pheromoneZero) {}
+	void update(ACSData &data, int from, int to) const
+	{
+		data.setPheromone(from, to, (1 - m_phi) * data.pheromone(from, to) + m_phi * m_pheromoneZero);
+	}
+
+private:
+	double m_phi;
+	double m_pheromoneZero;
+};
+
+// Global update rules, applied once per iteration after the local search.
+// tours holds every ant's tour and may be reordered. accept() handles a
+// tour received from another colony.
+
+// ACS: tau = (1 - ALPHA) tau on every edge, then 1/L on the iteration-best tour
+class ACSGlobalUpdate
+{
+public:
+	ACSGlobalUpdate(const ColonyParameters &params) : m_evaporation(params.evaporation) {}
+
+	void update(ACSData &data, QVector<Tour *> &tours, Tour *iterationBest, Tour *bestSoFar)
+	{
+		Q_UNUSED(tours);
+		Q_UNUSED(bestSoFar);
+		data.evaporate(1 - m_evaporation);
+		data.deposit(iterationBest, 1.0 / iterationBest->length());
+	}
+
+	void accept(ACSData &data, Tour *t)
+	{
+		data.deposit(t, 1.0 / t->length());
+	}
+
+private:
+	double m_evaporation;
+};
+
+// MAX-MIN Ant System: evaporation, 1/L on the iteration-best tour, then
+// every trail is kept within [tauMax / 2n, tauMax], tauMax = 1 / (rho Lbest)
+class MaxMinGlobalUpdate
+{
+public:
+	MaxMinGlobalUpdate(const ColonyParameters &params) : m_evaporation(params.evaporation), m_max(0), m_min(0) {}
+
+	void update(ACSData &data, QVector<Tour *> &tours, Tour *iterationBest, Tour *bestSoFar)
+	{
+		Q_UNUSED(tours);
+		data.evaporate(1 - m_evaporation);
+		data.deposit(iterationBest, 1.0 / iterationBest->length());
+		m_max = 1.0 / (m_evaporation * bestSoFar->length());
+		m_min = m_max / (2 * data.N);
+		data.clamp(m_min, m_max);
+	}
+
+	void accept(ACSData &data, Tour *t)
+	{
+		data.deposit(t, 1.0 / t->length());
+		if (m_max > 0) {
+			data.clamp(m_min, m_max);
+		}
+	}
+
+private:
+	double m_evaporation;
+	double m_max;
+	double m_min;
+};
+
+inline bool tourLessThan(Tour *a, Tour *b)
+{
+	return a->length() < b->length();
+}
+
+// Rank-based Ant System: evaporation, then the r-th best of the w - 1 best
+// ants deposits (w - r)/L and the best-so-far tour w/L
+class RankBasedGlobalUpdate
+{
+public:
+	RankBasedGlobalUpdate(const ColonyParameters &params) : m_evaporation(params.evaporation), m_weight(params.rankWeight) {}
+
+	void update(ACSData &data, QVector<Tour *> &tours, Tour *iterationBest, Tour *bestSoFar)
+	{
+		Q_UNUSED(iterationBest);
+		data.evaporate(1 - m_evaporation);
+		qSort(tours.begin(), tours.end(), tourLessThan);
+		for (int r = 1; r < m_weight && r <= tours.size(); ++r) {
+			data.deposit(tours.at(r - 1), double(m_weight - r) / tours.at(r - 1)->length());
+		}
+		data.deposit(bestSoFar, double(m_weight) / bestSoFar->length());
+	}
+
+	void accept(ACSData &data, Tour *t)
+	{
+		data.deposit(t, double(m_weight) / t->length());
+	}
+
+private:
+	double m_evaporation;
+	int m_weight;
+};
+
+// The ants and pheromone trails of one ACO run. The variant is fixed when the
+// colony is created (see createColony()); the per-iteration calls below are
+// the only virtual ones.
+class AntColony
+{
+public:
+	virtual ~AntColony() {}
+
+	// Every ant builds a new tour, applying the local update as it goes
+	virtual void constructTours() = 0;
+	virtual int ants() const = 0;
+	virtual Tour *tour(int k) = 0;
+	virtual void globalUpdate(Tour *iterationBest, Tour *bestSoFar) = 0;
+	virtual void acceptTour(Tour *t) = 0;
+	virtual ACSData *data() = 0;
+	// Where the phases of the colony are timed and counted, 0 for nowhere
+	virtual void setStats(SolveStats *stats) = 0;
+};
+
+AntColony *createColony(const DistanceMatrix *distances, const ColonyParameters &params, quint64 seed);
+
+template <class Transition, class LocalUpdate, class GlobalUpdate>
+class Colony : public AntColony
+{
+public:
+	Colony(const DistanceMatrix *distances, const ColonyParameters &params, quint64 seed)
+		: m_transition(params)
+		, m_localUpdate(params)
+		, m_globalUpdate(params)
+		, m_stats(0)
+	{
+		m_data.setDistances(distances, params.pheromoneZero);
+		int n = m_data.N;
+		double *eta = m_data.heuristicData();
+		for (int i = 0; i < n; ++i) {
+			for (int j = 0; j < n; ++j) {
+				int w = distances->distance(i, j);
+				eta[i * n + j] = i != j && w < DistanceMatrix::Infinity ? m_transition.heuristic(1.0 / qMax(w, 1)) : 0;
+			}
+		}
+
+		// each ant draws from its own stream of the seed
+		for (int k = 0; k < params.ants; ++k) {
+			m_ants.append(new Ant(&m_data, Random(seed, k)));
+		}
+		m_tours.resize(m_ants.size());
+	}
+
+	~Colony()
+	{
+		qDeleteAll(m_ants);
+	}
+
+	void constructTours()
+	{
+		int ants = m_ants.size();
+		// tours of the previous iteration are kept until now for globalUpdate()
+		for (int k = 0; k < ants; ++k) {
+			m_ants[k]->reset();
+		}
+		for (int i = 0; i < m_data.N; ++i) {
+			{
+				GIS_TIME_PHASE_N(m_stats, AntStep, ants);
+				for (int k = 0; k < ants; ++k) {
+					m_ants[k]->step(m_transition);
+				}
+			}
+			{
+				GIS_TIME_PHASE_N(m_stats, LocalUpdate, ants);
+				for (int k = 0; k < ants; ++k) {
+					m_ants[k]->localUpdate(m_localUpdate);
+				}
+			}
+		}
+		// every step but the closing one weighs all the unvisited vertices
+		GIS_COUNT(m_stats, DesirabilityEvaluations, qint64(ants) * m_data.N * (m_data.N - 1) / 2);
+	}
+
+	int ants() const
+	{
+		return m_ants.size();
+	}
+
+	Tour *tour(int k)
+	{
+		return m_ants[k]->tour();
+	}
+
+	void globalUpdate(Tour *iterationBest, Tour *bestSoFar)
+	{
+		GIS_TIME_PHASE(m_stats, GlobalUpdate);
+		for (int k = 0; k < m_ants.size(); ++k) {
+			m_tours[k] = m_ants[k]->tour();
+		}
+		m_globalUpdate.update(m_data, m_tours, iterationBest, bestSoFar);
+	}
+
+	void acceptTour(Tour *t)
+	{
+		m_globalUpdate.accept(m_data, t);
+	}
+
+	ACSData *data()
+	{
+		return &m_data;
+	}
+
+	void setStats(SolveStats *stats)
+	{
+		m_stats = stats;
+		m_data.setStats(stats);
+	}
+
+private:
+	ACSData m_data;
+	QList<Ant *> m_ants;
+	QVector<Tour *> m_tours;
+	Transition m_transition;
+	LocalUpdate m_localUpdate;
+	GlobalUpdate m_globalUpdate;
+	SolveStats *m_stats;
+};
+
+} // namespace GIS
+
+#endif // COLONY_H
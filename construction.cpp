@@ -0,0 +1,420 @@
+#include "construction.h"
+#include "distancematrix.h"
+
+#include <QtAlgorithms>
+
+namespace GIS {
+
+namespace {
+
+struct CandidateEdge {
+	int weight;
+	int from;
+	int to;
+};
+
+bool edgeLessThan(const CandidateEdge &e1, const CandidateEdge &e2)
+{
+	if (e1.weight != e2.weight) {
+		return e1.weight < e2.weight;
+	}
+	return e1.from < e2.from || (e1.from == e2.from && e1.to < e2.to);
+}
+
+int findRoot(QVector<int> &parent, int v)
+{
+	while (parent.at(v) != v) {
+		parent[v] = parent.at(parent.at(v));
+		v = parent.at(v);
+	}
+	return v;
+}
+
+// Tour of a cyclic successor list, starting at vertex 0
+QVector<int> sequence(const QVector<int> &next)
+{
+	QVector<int> tour(next.size());
+	int v = 0;
+	for (int i = 0; i < tour.size(); ++i) {
+		tour[i] = v;
+		v = next.at(v);
+	}
+	return tour;
+}
+
+// Tour rotated to start with vertex 0
+QVector<int> fromZero(const QVector<int> &tour)
+{
+	int n = tour.size();
+	int zero = tour.indexOf(0);
+	QVector<int> rotated(n);
+	for (int i = 0; i < n; ++i) {
+		rotated[i] = tour.at((zero + i) % n);
+	}
+	return rotated;
+}
+
+// Distance of (x, y) along the Hilbert curve through a 2^16 x 2^16 grid
+quint64 hilbertIndex(quint32 x, quint32 y)
+{
+	const quint32 side = 1u << 16;
+	quint64 index = 0;
+	for (quint32 s = side / 2; s > 0; s /= 2) {
+		quint32 rx = (x & s) ? 1 : 0;
+		quint32 ry = (y & s) ? 1 : 0;
+		index += quint64(s) * s * ((3 * rx) ^ ry);
+		// turn the quadrant so that the curve enters it at the origin
+		if (ry == 0) {
+			if (rx == 1) {
+				x = side - 1 - x;
+				y = side - 1 - y;
+			}
+			qSwap(x, y);
+		}
+	}
+	return index;
+}
+
+struct CurvePoint {
+	quint64 index;
+	int vertex;
+};
+
+bool curvePointLessThan(const CurvePoint &p1, const CurvePoint &p2)
+{
+	return p1.index < p2.index || (p1.index == p2.index && p1.vertex < p2.vertex);
+}
+
+// Cost of putting v between a and b
+inline int insertionCost(const DistanceMatrix *d, int a, int v, int b)
+{
+	return d->distance(a, v) + d->distance(v, b) - d->distance(a, b);
+}
+
+}
+
+/*!
+\class Construction
+*/
+QVector<int> Construction::tour(const DistanceMatrix *distances, Method method)
+{
+	switch (method) {
+	case NearestNeighbour:
+		return nearestNeighbour(distances);
+	case GreedyEdge:
+		return greedyEdge(distances);
+	case FarthestInsertion:
+		return farthestInsertion(distances);
+	case CheapestInsertion:
+		return cheapestInsertion(distances);
+	case SpaceFillingCurve:
+		return spaceFillingCurve(distances);
+	}
+	return QVector<int>();
+}
+
+QVector<int> Construction::nearestNeighbour(const DistanceMatrix *distances, int start)
+{
+	int n = distances->size();
+	QVector<int> tour(n);
+	if (n == 0) {
+		return tour;
+	}
+	QVector<bool> visited(n, false);
+	tour[0] = start;
+	visited[start] = true;
+	for (int i = 1; i < n; ++i) {
+		int last = tour.at(i - 1);
+		int next = -1;
+		int nextDistance = 0;
+		for (int v = 0; v < n; ++v) {
+			if (visited.at(v)) {
+				continue;
+			}
+			int distance = distances->distance(last, v);
+			if (next < 0 || distance < nextDistance) {
+				next = v;
+				nextDistance = distance;
+			}
+		}
+		tour[i] = next;
+		visited[next] = true;
+	}
+	return start != 0 ? fromZero(tour) : tour;
+}
+
+QVector<int> Construction::greedyEdge(const DistanceMatrix *distances)
+{
+	int n = distances->size();
+	if (n < 3) {
+		return nearestNeighbour(distances);
+	}
+
+	QVector<CandidateEdge> edges;
+	if (distances->isDense()) {
+		edges.reserve(n * (n - 1) / 2);
+		for (int i = 0; i < n; ++i) {
+			for (int j = i + 1; j < n; ++j) {
+				if (distances->distance(i, j) < DistanceMatrix::Infinity) {
+					CandidateEdge e = { distances->distance(i, j), i, j };
+					edges.append(e);
+				}
+			}
+		}
+	} else {
+		const int k = qMin(10, n - 1);
+		QVector<int> neighbours = distances->neighbourLists(k);
+		edges.reserve(n * k);
+		for (int i = 0; i < n; ++i) {
+			for (int j = 0; j < k; ++j) {
+				int v = neighbours.at(i * k + j);
+				CandidateEdge e = { distances->distance(i, v), qMin(i, v), qMax(i, v) };
+				edges.append(e);
+			}
+		}
+	}
+	qSort(edges.begin(), edges.end(), edgeLessThan);
+
+	// adjacent[2 v], adjacent[2 v + 1]: the neighbours of v, -1 if none
+	QVector<int> adjacent(2 * n, -1);
+	QVector<int> degree(n, 0);
+	QVector<int> parent(n);
+	for (int v = 0; v < n; ++v) {
+		parent[v] = v;
+	}
+	int added = 0;
+	for (int k = 0; k < edges.size() && added < n - 1; ++k) {
+		const CandidateEdge &e = edges.at(k);
+		if (degree.at(e.from) == 2 || degree.at(e.to) == 2) {
+			continue;
+		}
+		int rootFrom = findRoot(parent, e.from);
+		int rootTo = findRoot(parent, e.to);
+		if (rootFrom == rootTo) {
+			continue;
+		}
+		parent[rootFrom] = rootTo;
+		adjacent[2 * e.from + degree[e.from]++] = e.to;
+		adjacent[2 * e.to + degree[e.to]++] = e.from;
+		++added;
+	}
+
+	// the fragments are paths (single vertices included); they are chained
+	// nearest endpoint first, starting with the one holding vertex 0
+	QList<QVector<int> > fragments;
+	QVector<bool> used(n, false);
+	for (int v = 0; v < n; ++v) {
+		if (used.at(v) || degree.at(v) == 2) {
+			continue;
+		}
+		QVector<int> path;
+		int previous = -1;
+		int current = v;
+		while (current >= 0) {
+			path.append(current);
+			used[current] = true;
+			int next = adjacent.at(2 * current) != previous ? adjacent.at(2 * current) : adjacent.at(2 * current + 1);
+			previous = current;
+			current = next;
+		}
+		fragments.append(path);
+	}
+
+	QVector<int> tour;
+	tour.reserve(n);
+	for (int i = 0; i < fragments.size(); ++i) {
+		if (fragments.at(i).contains(0)) {
+			tour = fragments.takeAt(i);
+			break;
+		}
+	}
+	while (!fragments.isEmpty()) {
+		int last = tour.last();
+		int best = 0;
+		bool reversed = false;
+		int bestDistance = distances->distance(last, fragments.first().first());
+		for (int i = 0; i < fragments.size(); ++i) {
+			const QVector<int> &f = fragments.at(i);
+			int distance = distances->distance(last, f.first());
+			if (distance < bestDistance) {
+				best = i;
+				reversed = false;
+				bestDistance = distance;
+			}
+			distance = distances->distance(last, f.last());
+			if (distance < bestDistance) {
+				best = i;
+				reversed = true;
+				bestDistance = distance;
+			}
+		}
+		QVector<int> f = fragments.takeAt(best);
+		for (int i = 0; i < f.size(); ++i) {
+			tour.append(f.at(reversed ? f.size() - 1 - i : i));
+		}
+	}
+	return fromZero(tour);
+}
+
+QVector<int> Construction::farthestInsertion(const DistanceMatrix *distances)
+{
+	int n = distances->size();
+	if (n < 3) {
+		return nearestNeighbour(distances);
+	}
+
+	// next: successor in the tour, -1 outside; distance: to the nearest
+	// vertex of the tour
+	QVector<int> next(n, -1);
+	QVector<int> distance(n);
+	int farthest = 1;
+	for (int v = 1; v < n; ++v) {
+		distance[v] = distances->distance(0, v);
+		if (distance.at(v) > distance.at(farthest)) {
+			farthest = v;
+		}
+	}
+	next[0] = farthest;
+	next[farthest] = 0;
+	for (int v = 0; v < n; ++v) {
+		distance[v] = qMin(distance.at(v), distances->distance(farthest, v));
+	}
+
+	for (int size = 2; size < n; ++size) {
+		int v = -1;
+		for (int u = 0; u < n; ++u) {
+			if (next.at(u) < 0 && (v < 0 || distance.at(u) > distance.at(v))) {
+				v = u;
+			}
+		}
+		int bestTail = 0;
+		int bestCost = insertionCost(distances, 0, v, next.at(0));
+		for (int a = next.at(0); a != 0; a = next.at(a)) {
+			int cost = insertionCost(distances, a, v, next.at(a));
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestTail = a;
+			}
+		}
+		next[v] = next.at(bestTail);
+		next[bestTail] = v;
+		for (int u = 0; u < n; ++u) {
+			distance[u] = qMin(distance.at(u), distances->distance(v, u));
+		}
+	}
+	return sequence(next);
+}
+
+// Every outside vertex keeps its cheapest insertion edge (by its tail); only
+// the vertices whose edge was just replaced rescan the tour
+QVector<int> Construction::cheapestInsertion(const DistanceMatrix *distances)
+{
+	int n = distances->size();
+	if (n < 3) {
+		return nearestNeighbour(distances);
+	}
+
+	QVector<int> next(n, -1);
+	QVector<int> bestTail(n, 0);
+	QVector<int> bestCost(n, 0);
+	int nearest = 1;
+	for (int v = 2; v < n; ++v) {
+		if (distances->distance(0, v) < distances->distance(0, nearest)) {
+			nearest = v;
+		}
+	}
+	next[0] = nearest;
+	next[nearest] = 0;
+	for (int u = 0; u < n; ++u) {
+		if (next.at(u) < 0) {
+			bestTail[u] = 0;
+			bestCost[u] = insertionCost(distances, 0, u, nearest);
+			int cost = insertionCost(distances, nearest, u, 0);
+			if (cost < bestCost.at(u)) {
+				bestTail[u] = nearest;
+				bestCost[u] = cost;
+			}
+		}
+	}
+
+	for (int size = 2; size < n; ++size) {
+		int v = -1;
+		for (int u = 0; u < n; ++u) {
+			if (next.at(u) < 0 && (v < 0 || bestCost.at(u) < bestCost.at(v))) {
+				v = u;
+			}
+		}
+		int a = bestTail.at(v);
+		int b = next.at(a);
+		next[v] = b;
+		next[a] = v;
+
+		for (int u = 0; u < n; ++u) {
+			if (next.at(u) >= 0) {
+				continue;
+			}
+			if (bestTail.at(u) == a) {
+				// a -> b is gone, scan the whole tour
+				bestTail[u] = 0;
+				bestCost[u] = insertionCost(distances, 0, u, next.at(0));
+				for (int t = next.at(0); t != 0; t = next.at(t)) {
+					int cost = insertionCost(distances, t, u, next.at(t));
+					if (cost < bestCost.at(u)) {
+						bestCost[u] = cost;
+						bestTail[u] = t;
+					}
+				}
+				continue;
+			}
+			int cost = insertionCost(distances, a, u, v);
+			if (cost < bestCost.at(u)) {
+				bestCost[u] = cost;
+				bestTail[u] = a;
+			}
+			cost = insertionCost(distances, v, u, b);
+			if (cost < bestCost.at(u)) {
+				bestCost[u] = cost;
+				bestTail[u] = v;
+			}
+		}
+	}
+	return sequence(next);
+}
+
+// The positions are scaled to the grid by their bounding box
+QVector<int> Construction::spaceFillingCurve(const DistanceMatrix *distances)
+{
+	int n = distances->size();
+	if (!distances->hasPositions() || n < 3) {
+		return nearestNeighbour(distances);
+	}
+
+	const QVector<double> &x = distances->points().x();
+	const QVector<double> &y = distances->points().y();
+	double minX = x.at(0);
+	double maxX = minX;
+	double minY = y.at(0);
+	double maxY = minY;
+	for (int v = 1; v < n; ++v) {
+		minX = qMin(minX, x.at(v));
+		maxX = qMax(maxX, x.at(v));
+		minY = qMin(minY, y.at(v));
+		maxY = qMax(maxY, y.at(v));
+	}
+	double extent = qMax(maxX - minX, maxY - minY);
+	double scale = extent > 0 ? 65535 / extent : 0;
+
+	QVector<CurvePoint> points(n);
+	for (int v = 0; v < n; ++v) {
+		points[v].index = hilbertIndex(quint32((x.at(v) - minX) * scale), quint32((y.at(v) - minY) * scale));
+		points[v].vertex = v;
+	}
+	qSort(points.begin(), points.end(), curvePointLessThan);
+	QVector<int> tour(n);
+	for (int i = 0; i < n; ++i) {
+		tour[i] = points.at(i).vertex;
+	}
+	return fromZero(tour);
+}
+
+} // namespace GIS
@@ -0,0 +1,45 @@
+#ifndef CONSTRUCTION_H
+#define CONSTRUCTION_H
+
+#include <QVector>
+
+namespace GIS {
+
+class DistanceMatrix;
+
+// Fast tour construction heuristics on a DistanceMatrix, O(n^2) up to
+// O(n^2 log n) for the greedy edge one, O(n log n) for the space-filling
+// curve. Tours are sequences of vertex indices starting with vertex 0 (not
+// repeated at the end). Missing edges are avoided where the heuristic has a
+// choice.
+class Construction
+{
+public:
+	enum Method {
+		NearestNeighbour,
+		GreedyEdge,
+		FarthestInsertion,
+		CheapestInsertion,
+		SpaceFillingCurve
+	};
+
+	static QVector<int> tour(const DistanceMatrix *distances, Method method);
+
+	// Always moves to the nearest unvisited vertex
+	static QVector<int> nearestNeighbour(const DistanceMatrix *distances, int start = 0);
+	// Adds the shortest edges that keep every degree at most 2 and close no
+	// cycle, then joins the fragments. Without a dense matrix only the edges
+	// to the 10 nearest neighbours are candidates.
+	static QVector<int> greedyEdge(const DistanceMatrix *distances);
+	// Inserts the vertex farthest from the tour where it costs least
+	static QVector<int> farthestInsertion(const DistanceMatrix *distances);
+	// Inserts the vertex that costs least, where it costs least
+	static QVector<int> cheapestInsertion(const DistanceMatrix *distances);
+	// Visits the vertices in the order of a Hilbert curve through their
+	// positions; nearest neighbour if they have none
+	static QVector<int> spaceFillingCurve(const DistanceMatrix *distances);
+};
+
+} // namespace GIS
+
+#endif // CONSTRUCTION_H
@@ -0,0 +1,131 @@
+#include "convergencetrace.h"
+
+#include <QFile>
+#include <QStringList>
+
+#include "colony.h"
+
+namespace GIS {
+
+static const double Lambda = 0.05;
+
+/*!
+\class ConvergenceTrace
+*/
+void ConvergenceTrace::setCapacity(int samples)
+{
+	m_samples.resize(qMax(samples, 0));
+	clear();
+}
+
+void ConvergenceTrace::clear()
+{
+	m_size = 0;
+	m_stride = 1;
+}
+
+void ConvergenceTrace::append(const Sample &sample)
+{
+	if (!wants(sample.iteration, sample.improved)) {
+		return;
+	}
+	if (m_size == capacity()) {
+		compact();
+		if (!wants(sample.iteration, sample.improved)) {
+			return;
+		}
+	}
+	if (m_size == capacity()) {
+		// nothing but improvements: the newest one replaces the previous
+		if (!sample.improved) {
+			return;
+		}
+		--m_size;
+	}
+	m_samples[m_size++] = sample;
+}
+
+// Doubles the stride and drops the samples off it, in place
+void ConvergenceTrace::compact()
+{
+	m_stride *= 2;
+	int kept = 0;
+	for (int i = 0; i < m_size; ++i) {
+		const Sample &s = m_samples.at(i);
+		if (s.improved || s.iteration % m_stride == 0) {
+			m_samples[kept++] = s;
+		}
+	}
+	m_size = kept;
+}
+
+double ConvergenceTrace::branchingFactor(const ACSData *data)
+{
+	int n = data->N;
+	if (n < 2) {
+		return 0;
+	}
+	int branches = 0;
+	for (int i = 0; i < n; ++i) {
+		const double *row = data->pheromoneRow(i);
+		double low = 0;
+		double high = 0;
+		bool first = true;
+		for (int j = 0; j < n; ++j) {
+			if (j == i) {
+				continue;
+			}
+			if (first || row[j] < low) {
+				low = row[j];
+			}
+			if (first || row[j] > high) {
+				high = row[j];
+			}
+			first = false;
+		}
+		double cut = low + Lambda * (high - low);
+		for (int j = 0; j < n; ++j) {
+			if (j != i && row[j] >= cut) {
+				++branches;
+			}
+		}
+	}
+	return double(branches) / n;
+}
+
+QString ConvergenceTrace::toCsv() const
+{
+	QStringList lines;
+	lines << "iteration,iterationBest,globalBest,meanLength,branchingFactor,msec";
+	for (int i = 0; i < m_size; ++i) {
+		const Sample &s = m_samples.at(i);
+		lines << QString("%1,%2,%3,%4,%5,%6").arg(s.iteration).arg(s.iterationBest).arg(s.globalBest)
+				 .arg(s.meanLength, 0, 'f', 2).arg(s.branchingFactor, 0, 'f', 3).arg(s.msec, 0, 'f', 3);
+	}
+	return lines.join("\n") + "\n";
+}
+
+QString ConvergenceTrace::toJson() const
+{
+	QStringList samples;
+	for (int i = 0; i < m_size; ++i) {
+		const Sample &s = m_samples.at(i);
+		samples << QString("{\"iteration\":%1,\"iterationBest\":%2,\"globalBest\":%3,"
+						   "\"meanLength\":%4,\"branchingFactor\":%5,\"msec\":%6}")
+				   .arg(s.iteration).arg(s.iterationBest).arg(s.globalBest)
+				   .arg(s.meanLength, 0, 'f', 2).arg(s.branchingFactor, 0, 'f', 3).arg(s.msec, 0, 'f', 3);
+	}
+	return "[" + samples.join(",") + "]";
+}
+
+bool ConvergenceTrace::save(const QString &fileName) const
+{
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly | QFile::Text | QFile::Truncate)) {
+		return false;
+	}
+	QString text = fileName.endsWith(".json", Qt::CaseInsensitive) ? toJson() + "\n" : toCsv();
+	return file.write(text.toUtf8()) >= 0;
+}
+
+} // namespace GIS
@@ -0,0 +1,73 @@
+#ifndef CONVERGENCETRACE_H
+#define CONVERGENCETRACE_H
+
+#include <QString>
+#include <QVector>
+
+namespace GIS {
+
+class ACSData;
+
+// Trajectory of an ACS run, one sample per iteration. The buffer is
+// allocated by setCapacity() and never grows: once it is full every other
+// sample is dropped and only every second iteration is kept from then on,
+// so a long run keeps an evenly spaced trace. Samples that improved the
+// best tour are always kept.
+class ConvergenceTrace
+{
+public:
+	struct Sample {
+		int iteration;
+		int iterationBest;
+		int globalBest;
+		double meanLength;
+		// lambda-branching factor of the trails (lambda = 0.05): edges per
+		// vertex whose pheromone is in the top 95% of the vertex's range;
+		// 2 is a converged colony, n - 1 a uniform one
+		double branchingFactor;
+		double msec;
+		bool improved;
+	};
+
+	ConvergenceTrace() : m_size(0), m_stride(1) {}
+
+	// Preallocates the buffer and clears it; 0 records nothing
+	void setCapacity(int samples);
+	int capacity() const { return m_samples.size(); }
+	void clear();
+
+	bool isEmpty() const { return m_size == 0; }
+	int size() const { return m_size; }
+	const Sample &at(int i) const { return m_samples.at(i); }
+	const Sample &last() const { return m_samples.at(m_size - 1); }
+	// Iterations between the kept samples that did not improve the best tour
+	int stride() const { return m_stride; }
+
+	// Whether the sample of the iteration would be kept, so that the caller
+	// can skip computing it
+	bool wants(int iteration, bool improved) const
+	{
+		return capacity() > 0 && (improved || iteration % m_stride == 0);
+	}
+	void append(const Sample &sample);
+
+	static double branchingFactor(const ACSData *data);
+
+	// Header line and one line per sample
+	QString toCsv() const;
+	// Array of objects with the names of the CSV columns
+	QString toJson() const;
+	// CSV, or JSON if the name ends with .json
+	bool save(const QString &fileName) const;
+
+private:
+	void compact();
+
+	QVector<Sample> m_samples;
+	int m_size;
+	int m_stride;
+};
+
+} // namespace GIS
+
+#endif // CONVERGENCETRACE_H
@@ -0,0 +1,11 @@
+# Links a project of this directory against the core library (core.pro)
+
+QT *= core xml
+
+win32-msvc* {
+    CORE_LIBRARY = $$OUT_PWD/gis-core.lib
+} else {
+    CORE_LIBRARY = $$OUT_PWD/libgis-core.a
+}
+LIBS += -L$$OUT_PWD -lgis-core
+PRE_TARGETDEPS += $$CORE_LIBRARY
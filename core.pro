@@ -0,0 +1,61 @@
+TEMPLATE = lib
+TARGET = gis-core
+CONFIG += staticlib
+DESTDIR = $$OUT_PWD
+OBJECTS_DIR = obj/core
+
+QT = core xml
+
+HEADERS += \
+    graph.h \
+    singletons.h \
+    random.h \
+    distancematrix.h \
+    euclideandistance.h \
+    kdtree.h \
+    localsearch.h \
+    multicolony.h \
+    desirability.h \
+    colony.h \
+    canceltoken.h \
+    bruteforce.h \
+    branchandbound.h \
+    heldkarp.h \
+    construction.h \
+    twolevellist.h \
+    tourneighbourhood.h \
+    iteratedlocalsearch.h \
+    lowerbound.h \
+    batchsolver.h \
+    metricclosure.h \
+    graphgenerator.h \
+    instrumentation.h \
+    logging.h \
+    convergencetrace.h
+
+SOURCES += \
+    graph.cpp \
+    distancematrix.cpp \
+    kdtree.cpp \
+    localsearch.cpp \
+    multicolony.cpp \
+    desirability.cpp \
+    colony.cpp \
+    bruteforce.cpp \
+    branchandbound.cpp \
+    heldkarp.cpp \
+    construction.cpp \
+    twolevellist.cpp \
+    iteratedlocalsearch.cpp \
+    lowerbound.cpp \
+    batchsolver.cpp \
+    metricclosure.cpp \
+    graphgenerator.cpp \
+    instrumentation.cpp \
+    logging.cpp \
+    convergencetrace.cpp
+
+# removes the timers and counters of the hot paths (instrumentation.h)
+# DEFINES += GIS_NO_INSTRUMENTATION
+# removes the log records below a GIS::Log::Level (logging.h), e.g. debug
+# DEFINES += GIS_LOG_LEVEL=1
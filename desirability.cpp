@@ -0,0 +1,189 @@
+#include "desirability.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GIS_DESIRABILITY_X86
+#include <immintrin.h>
+#endif
+
+namespace GIS {
+
+namespace Desirability {
+
+static void productScalar(const double *tau, const double *eta, const int *candidates, int n, double *out)
+{
+	for (int i = 0; i < n; ++i) {
+		int v = candidates[i];
+		out[i] = tau[v] * eta[v];
+	}
+}
+
+// Not vectorised: a parallel scan adds in another order, and the roulette
+// wheel would then pick other vertices from the same seed on other CPUs
+static double prefixSumScalar(double *values, int n)
+{
+	double sum = 0;
+	for (int i = 0; i < n; ++i) {
+		sum += values[i];
+		values[i] = sum;
+	}
+	return sum;
+}
+
+static int argMaxScalar(const double *values, int n)
+{
+	int best = 0;
+	for (int i = 1; i < n; ++i) {
+		if (values[i] > values[best]) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+#ifdef GIS_DESIRABILITY_X86
+
+// The vector loops handle whole registers, the remainder goes through the
+// scalar code
+
+__attribute__((target("avx2")))
+static void productAvx2(const double *tau, const double *eta, const int *candidates, int n, double *out)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i idx = _mm_loadu_si128((const __m128i *)(candidates + i));
+		__m256d t = _mm256_i32gather_pd(tau, idx, 8);
+		__m256d e = _mm256_i32gather_pd(eta, idx, 8);
+		_mm256_storeu_pd(out + i, _mm256_mul_pd(t, e));
+	}
+	productScalar(tau, eta, candidates + i, n - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static int argMaxAvx2(const double *values, int n)
+{
+	double best = values[0];
+	int i = 0;
+	if (n >= 4) {
+		__m256d m = _mm256_loadu_pd(values);
+		for (i = 4; i + 4 <= n; i += 4) {
+			m = _mm256_max_pd(m, _mm256_loadu_pd(values + i));
+		}
+		__m128d h = _mm_max_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+		best = _mm_cvtsd_f64(_mm_max_sd(h, _mm_unpackhi_pd(h, h)));
+	}
+	for (; i < n; ++i) {
+		if (values[i] > best) {
+			best = values[i];
+		}
+	}
+
+	const __m256d b = _mm256_set1_pd(best);
+	for (i = 0; i + 4 <= n; i += 4) {
+		int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), b, _CMP_EQ_OQ));
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+	for (; i < n; ++i) {
+		if (values[i] == best) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+__attribute__((target("avx512f")))
+static void productAvx512(const double *tau, const double *eta, const int *candidates, int n, double *out)
+{
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i idx = _mm256_loadu_si256((const __m256i *)(candidates + i));
+		__m512d t = _mm512_i32gather_pd(idx, tau, 8);
+		__m512d e = _mm512_i32gather_pd(idx, eta, 8);
+		_mm512_storeu_pd(out + i, _mm512_mul_pd(t, e));
+	}
+	productScalar(tau, eta, candidates + i, n - i, out + i);
+}
+
+__attribute__((target("avx512f")))
+static int argMaxAvx512(const double *values, int n)
+{
+	double best = values[0];
+	int i = 0;
+	if (n >= 8) {
+		__m512d m = _mm512_loadu_pd(values);
+		for (i = 8; i + 8 <= n; i += 8) {
+			m = _mm512_max_pd(m, _mm512_loadu_pd(values + i));
+		}
+		best = _mm512_reduce_max_pd(m);
+	}
+	for (; i < n; ++i) {
+		if (values[i] > best) {
+			best = values[i];
+		}
+	}
+
+	const __m512d b = _mm512_set1_pd(best);
+	for (i = 0; i + 8 <= n; i += 8) {
+		unsigned mask = _mm512_cmp_pd_mask(_mm512_loadu_pd(values + i), b, _CMP_EQ_OQ);
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+	for (; i < n; ++i) {
+		if (values[i] == best) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+#endif // GIS_DESIRABILITY_X86
+
+struct Kernels {
+	void (*product)(const double *, const double *, const int *, int, double *);
+	int (*argMax)(const double *, int);
+	const char *name;
+};
+
+static Kernels selectKernels()
+{
+	Kernels kernels = { productScalar, argMaxScalar, "scalar" };
+#ifdef GIS_DESIRABILITY_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		Kernels avx512 = { productAvx512, argMaxAvx512, "avx512" };
+		kernels = avx512;
+	} else if (__builtin_cpu_supports("avx2")) {
+		Kernels avx2 = { productAvx2, argMaxAvx2, "avx2" };
+		kernels = avx2;
+	}
+#endif
+	return kernels;
+}
+
+static const Kernels s_kernels = selectKernels();
+
+void product(const double *tau, const double *eta, const int *candidates, int n, double *out)
+{
+	s_kernels.product(tau, eta, candidates, n, out);
+}
+
+double prefixSum(double *values, int n)
+{
+	return prefixSumScalar(values, n);
+}
+
+int argMax(const double *values, int n)
+{
+	return s_kernels.argMax(values, n);
+}
+
+const char *implementation()
+{
+	return s_kernels.name;
+}
+
+} // namespace Desirability
+
+} // namespace GIS
@@ -0,0 +1,30 @@
+#ifndef DESIRABILITY_H
+#define DESIRABILITY_H
+
+namespace GIS {
+
+// Kernels of the ACS transition rule, evaluated over the candidate set of an
+// ant, i.e. the unvisited vertices given as an index list into one row of the
+// pheromone and heuristic arrays.
+// The implementation is picked once at startup from what the CPU supports:
+// AVX-512, AVX2 or plain C++. Every version computes the same bits, so a
+// seed gives the same tours on any CPU.
+namespace Desirability {
+
+// out[i] = tau[candidates[i]] * eta[candidates[i]]
+void product(const double *tau, const double *eta, const int *candidates, int n, double *out);
+
+// Inclusive prefix sum in place, returns the total (0 if n is 0)
+double prefixSum(double *values, int n);
+
+// Index of the first largest value, n must be positive
+int argMax(const double *values, int n);
+
+// "avx512", "avx2" or "scalar"
+const char *implementation();
+
+} // namespace Desirability
+
+} // namespace GIS
+
+#endif // DESIRABILITY_H
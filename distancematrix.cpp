@@ -0,0 +1,141 @@
+#include "distancematrix.h"
+#include "graph.h"
+#include "kdtree.h"
+
+#include <QtAlgorithms>
+#include <algorithm>
+
+namespace GIS {
+
+static bool vertexLabelLessThan(Vertex *v1, Vertex *v2)
+{
+	return v1->label() < v2->label();
+}
+
+/*!
+\class DistanceMatrix
+*/
+const int DistanceMatrix::Infinity;
+const int DistanceMatrix::MaxDenseSize;
+
+DistanceMatrix::DistanceMatrix()
+	: m_size(0)
+	, m_dense(true)
+{
+}
+
+DistanceMatrix::DistanceMatrix(const Graph *graph)
+	: m_size(0)
+	, m_dense(true)
+{
+	setGraph(graph);
+}
+
+bool DistanceMatrix::isDenseGraph(const Graph *graph)
+{
+	return !graph->isEuclidean() || graph->vertices().size() <= MaxDenseSize;
+}
+
+void DistanceMatrix::setGraph(const Graph *graph)
+{
+	QList<Vertex *> verts = graph->vertices();
+	qSort(verts.begin(), verts.end(), vertexLabelLessThan);
+
+	m_size = verts.size();
+	m_vertices = QVector<Vertex *>::fromList(verts);
+	m_indices.clear();
+	for (int i = 0; i < m_size; ++i) {
+		m_indices.insert(m_vertices.at(i), i);
+	}
+
+	m_points = EuclideanDistance();
+	if (graph->isEuclidean()) {
+		QVector<double> x(m_size);
+		QVector<double> y(m_size);
+		for (int i = 0; i < m_size; ++i) {
+			x[i] = m_vertices.at(i)->x();
+			y[i] = m_vertices.at(i)->y();
+		}
+		m_points.setPoints(x, y, graph->euclideanType());
+	}
+	m_dense = isDenseGraph(graph);
+	if (!m_dense) {
+		m_distances.clear();
+		return;
+	}
+
+	m_distances.fill(Infinity, m_size * m_size);
+	if (hasPositions()) {
+		for (int i = 0; i < m_size; ++i) {
+			for (int j = 0; j < m_size; ++j) {
+				m_distances[i * m_size + j] = m_points(i, j);
+			}
+		}
+		return;
+	}
+	for (int i = 0; i < m_size; ++i) {
+		m_distances[i * m_size + i] = 0;
+		QList<Edge *> edges = m_vertices.at(i)->edges();
+		foreach (Edge *e, edges) {
+			Vertex *other = e->startPoint() == m_vertices.at(i) ? e->endPoint() : e->startPoint();
+			m_distances[i * m_size + m_indices.value(other)] = e->weight();
+		}
+	}
+}
+
+struct NeighbourLessThan {
+	NeighbourLessThan(const int *row) : row(row) {}
+	bool operator()(int a, int b) const {
+		return row[a] < row[b] || (row[a] == row[b] && a < b);
+	}
+	const int *row;
+};
+
+QVector<int> DistanceMatrix::neighbourLists(int k) const
+{
+	if (m_size < 2) {
+		return QVector<int>();
+	}
+	k = qMin(k, m_size - 1);
+	QVector<int> result(m_size * k);
+	if (hasPositions()) {
+		KdTree tree(m_points.x(), m_points.y());
+		for (int i = 0; i < m_size; ++i) {
+			QVector<int> nearest = tree.nearest(m_points.x().at(i), m_points.y().at(i), k, i);
+			for (int j = 0; j < k; ++j) {
+				result[i * k + j] = nearest.at(j);
+			}
+		}
+		return result;
+	}
+	QVector<int> candidates(m_size - 1);
+	for (int i = 0; i < m_size; ++i) {
+		int c = 0;
+		for (int j = 0; j < m_size; ++j) {
+			if (j != i) {
+				candidates[c++] = j;
+			}
+		}
+		std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), NeighbourLessThan(row(i)));
+		for (int j = 0; j < k; ++j) {
+			result[i * k + j] = candidates.at(j);
+		}
+	}
+	return result;
+}
+
+int DistanceMatrix::tourLength(const QVector<int> &tour) const
+{
+	int total = 0;
+	for (int i = 0; i < tour.size(); ++i) {
+		total += distance(tour.at(i), tour.at((i + 1) % tour.size()));
+	}
+	return total;
+}
+
+bool DistanceMatrix::hasMissingEdges() const
+{
+	return m_dense && m_distances.contains(Infinity);
+}
+
+} // namespace GIS
@@ -0,0 +1,62 @@
+#ifndef DISTANCEMATRIX_H
+#define DISTANCEMATRIX_H
+
+#include <QHash>
+#include <QVector>
+
+#include "euclideandistance.h"
+
+namespace GIS {
+
+class Graph;
+class Vertex;
+
+// Dense, index based view of a (complete) graph used by the solvers.
+// Vertices are ordered by label, so indices do not depend on hashing.
+// The distances of a Euclidean graph (see Graph::isEuclidean()) come from
+// the vertex positions; they are only stored up to MaxDenseSize vertices,
+// above that they are computed on every distance() call and row() is not
+// available.
+class DistanceMatrix
+{
+public:
+	DistanceMatrix();
+	explicit DistanceMatrix(const Graph *graph);
+
+	void setGraph(const Graph *graph);
+
+	int size() const { return m_size; }
+	Vertex *vertex(int i) const { return m_vertices.at(i); }
+	int indexOf(Vertex *v) const { return m_indices.value(v, -1); }
+	int distance(int i, int j) const { return m_dense ? m_distances.at(i * m_size + j) : m_points(i, j); }
+	// Only if isDense()
+	const int *row(int i) const { return m_distances.constData() + i * m_size; }
+	bool isDense() const { return m_dense; }
+	// Whether the matrix of the graph would be dense, without building it
+	static bool isDenseGraph(const Graph *graph);
+	// Positions of the vertices of a Euclidean graph, indexed like them
+	bool hasPositions() const { return m_points.size() > 0; }
+	const EuclideanDistance &points() const { return m_points; }
+
+	// k nearest vertices of every vertex, flat array of size() * k entries;
+	// found with a KdTree if the vertices have positions
+	QVector<int> neighbourLists(int k) const;
+	int tourLength(const QVector<int> &tour) const;
+	bool hasMissingEdges() const;
+
+	static const int Infinity = 10000000;
+	// 64 MB of distances
+	static const int MaxDenseSize = 4096;
+
+private:
+	int m_size;
+	QVector<Vertex *> m_vertices;
+	QHash<Vertex *, int> m_indices;
+	QVector<int> m_distances;
+	EuclideanDistance m_points;
+	bool m_dense;
+};
+
+} // namespace GIS
+
+#endif // DISTANCEMATRIX_H
@@ -0,0 +1,68 @@
+#ifndef EUCLIDEANDISTANCE_H
+#define EUCLIDEANDISTANCE_H
+
+#include <QVector>
+#include <qmath.h>
+
+namespace GIS {
+
+// Integer distances computed on the fly from point coordinates, kept as
+// separate x and y arrays. The rounding follows the TSPLIB edge weight types
+// of the same names: EUC_2D rounds to the nearest integer, CEIL_2D up and
+// ATT is the pseudo-Euclidean distance of the att48 / att532 instances.
+class EuclideanDistance
+{
+public:
+	enum Type {
+		Euc2D,
+		Ceil2D,
+		Att
+	};
+
+	EuclideanDistance() : m_type(Euc2D) {}
+
+	void setPoints(const QVector<double> &x, const QVector<double> &y, Type type) {
+		m_x = x;
+		m_y = y;
+		m_type = type;
+	}
+
+	int size() const { return m_x.size(); }
+	Type type() const { return m_type; }
+	const QVector<double> &x() const { return m_x; }
+	const QVector<double> &y() const { return m_y; }
+
+	int operator()(int i, int j) const {
+		return weight(m_type, m_x.at(i) - m_x.at(j), m_y.at(i) - m_y.at(j));
+	}
+
+	static int weight(Type type, double dx, double dy) {
+		double squared = dx * dx + dy * dy;
+		switch (type) {
+		case Ceil2D:
+			return int(qCeil(qSqrt(squared)));
+		case Att:
+			{
+				double r = qSqrt(squared / 10.0);
+				int t = int(r + 0.5);
+				return t < r ? t + 1 : t;
+			}
+		case Euc2D:
+			break;
+		}
+		return int(qSqrt(squared) + 0.5);
+	}
+
+	bool operator==(const EuclideanDistance &other) const {
+		return m_type == other.m_type && m_x == other.m_x && m_y == other.m_y;
+	}
+
+private:
+	QVector<double> m_x;
+	QVector<double> m_y;
+	Type m_type;
+};
+
+} // namespace GIS
+
+#endif // EUCLIDEANDISTANCE_H
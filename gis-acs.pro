@@ -1,24 +1,19 @@
-TEMPLATE = app
-TARGET = gis-acs
+TEMPLATE = subdirs
 
-QT += xml
+# core: the graph and the solvers as a static library, no GUI
+# gui: the Qt application
+# cli: the headless solver
+# bench: the benchmarks of the core library
+SUBDIRS = core gui cli bench
 
-HEADERS += \
-    graph.h \
-    graphmodel.h \
-    mainwindow.h \
-    singletons.h \
-    graphgeneratorwidget.h
-
-SOURCES += \
-    graph.cpp \
-    main.cpp \
-    graphmodel.cpp \
-    mainwindow.cpp \
-    graphgeneratorwidget.cpp
-
-OTHER_FILES += \
-    test_short_paths.xml
-
-FORMS += \
-    mainwindow.ui
+core.file = core.pro
+core.makefile = Makefile.core
+gui.file = gui.pro
+gui.makefile = Makefile.gui
+gui.depends = core
+cli.file = cli.pro
+cli.makefile = Makefile.cli
+cli.depends = core
+bench.file = bench.pro
+bench.makefile = Makefile.bench
+bench.depends = core
@@ -3,286 +3,481 @@
 #include <qmath.h>
 #include <QDomDocument>
 #include <QtDebug>
-#include <QDateTime>
 #include <QTextCodec>
+#include <QTextStream>
 
 #include "singletons.h"
+#include "localsearch.h"
+#include "multicolony.h"
+#include "colony.h"
+#include "canceltoken.h"
+#include "bruteforce.h"
+#include "branchandbound.h"
+#include "heldkarp.h"
+#include "construction.h"
+#include "iteratedlocalsearch.h"
+#include "lowerbound.h"
+#include "metricclosure.h"
+#include "instrumentation.h"
+#include "logging.h"
 
 
 namespace GIS {
 
-class ACSData
+void Tour::reset(int start)
 {
-private:
-	QHash<Edge*, double> m_pheromones;
-	Graph* m_graph;
-
-public:
-
-	void setGraph(Graph* g)
-	{
-		m_graph = g;
-
-		N = g->vertices().size();
-
-		// init ACSData
-		foreach(Vertex* v, g->vertices())
-		{
-			QList<Edge*> edges = v->edges();
-
-			foreach(Edge* e, edges)
-			{
-				addEdge(e);
-			}
-		}
-	}
-
-	QList<Edge*> edges()
-	{
-		return m_pheromones.keys();
-	}
-
-	void addEdge(Edge* e)
-	{
-		m_pheromones[e] = ACSParameters::instance().pheromoneZero();
-	}
+    if(m_sequence.size() != m_distances->size())
+    {
+        m_sequence.resize(m_distances->size());
+        GIS_COUNT(StatsScope::current(), Allocations, 1);
+    }
+    m_sequence[0] = start;
+    m_size = 1;
+    m_tourLength = 0;
+}
 
-	void addEdge(Edge* e, double pheromone)
-	{
-		m_pheromones[e] = pheromone;
-	}
+void Tour::addStep(int v)
+{
+    m_tourLength += m_distances->distance(m_sequence[m_size - 1], v);
+    m_sequence[m_size++] = v;
+}
 
-	double pheromone(Edge* e)
-	{
-		return m_pheromones[e];
-	}
+// Adds the edge back to the start vertex
+void Tour::close()
+{
+    m_tourLength += m_distances->distance(m_sequence[m_size - 1], m_sequence[0]);
+}
 
-	void setPheromone(Edge* e, double pheromone)
-	{
-		m_pheromones[e] = pheromone;
-	}
+// Copies the other tour into this tour's own buffer
+void Tour::assign(const Tour &other)
+{
+    setSequence(other.m_sequence, other.m_tourLength);
+    m_size = other.m_size;
+}
 
-	int N;
-	static const int K = 10;
-//	static const double BETA = 0.6;
-//	static const int pheromone0 = 10;
-//	static const double PHI = 0.9;
-};
+void Tour::setSequence(const QVector<int> &sequence, int length)
+{
+    if(m_sequence.size() != sequence.size())
+    {
+        m_sequence.resize(sequence.size());
+    }
+    int* dst = m_sequence.data();
+    const int* src = sequence.constData();
+    for(int i = 0; i < sequence.size(); ++i)
+    {
+        dst[i] = src[i];
+    }
+    m_size = sequence.size();
+    m_tourLength = length;
+}
 
+bool Tour::isEmpty()
+{
+    return m_size == 0;
+}
 
-void Tour::addStep(Edge* e)
+int Tour::size()
 {
-    m_tour.append(e);
-    m_tourLength += e->weight();
-    qDebug() << "Waga ścieżki: " << e->weight() << " m_length: " << m_tourLength;
+    return m_size;
 }
 
-bool Tour::contains(Edge* e)
+const QVector<int> &Tour::sequence()
 {
-    return m_tour.contains(e);
+    return m_sequence;
 }
 
 Vertex* Tour::startPoint()
 {
-    return m_startPoint;
+    return m_distances->vertex(m_sequence[0]);
 }
 
-Path* Tour::toPath()
+// Visiting order, starting at startPoint() (which is not repeated at the end)
+QList<Vertex*> Tour::vertices()
 {
     QList<Vertex*> rlist;
-
-    rlist.append(m_startPoint);
-    Vertex* curr = m_startPoint;
-    qDebug() << "start point: " << m_startPoint->label();
-    for(int i = 0; i < m_tour.size(); ++i)
+    for(int i = 0; i < m_size; ++i)
     {
-        Edge* e = m_tour[i];
-        //qDebug() << "start: " << e->startPoint()->label() << " end: " << e->endPoint()->label();
-        if(e->startPoint()->label() == curr->label())
-        {
-            //qDebug() << "curr: " << curr->label() << " adding: " << e->endPoint()->label();
-            qDebug() << " adding: " << e->endPoint()->label();
-            rlist.append(e->endPoint());
-            curr = e->endPoint();
-        }
-        else
-        {
-            //qDebug() << "curr: " << curr->label() << " adding: " << e->startPoint()->label();
-            qDebug() << " adding: " << e->startPoint()->label();
-            rlist.append(e->startPoint());
-            curr = e->startPoint();
-        }
+        rlist.append(m_distances->vertex(m_sequence[i]));
     }
-    Path* p = new Path();
+    return rlist;
+}
+
+Path* Tour::toPath()
+{
+    QList<Vertex*> rlist = vertices();
+    rlist.append(startPoint());
+
+    Path* p = new Path(startPoint()->graph());
     p->setVertices(rlist);
     return p;
 }
 
 Path* Tour::toFullPath()
 {
-    return toPath()->getFullPath();
+    Path* path = toPath();
+    Path* fullPath = path->getFullPath();
+    delete path;
+    return fullPath;
 }
 
-double Tour::length()
+int Tour::length()
 {
     return m_tourLength;
 }
 
-Edge* Tour::last()
-{
-    return m_tour.last();
-}
 
 
+ACS::ACS(Graph* g)
+    : m_bestTour(&m_distances)
+{
+    setup(g, ACSParameters::instance().seed());
+}
 
-Ant::Ant(QList<Vertex*> vertices, ACSData* acsData)
+ACS::ACS(Graph* g, quint64 seed)
+    : m_bestTour(&m_distances)
 {
-    qDebug() << "\tant() vertices.size() " << vertices.size();
+    setup(g, seed);
+}
 
-    qsrand(QDateTime::currentMSecsSinceEpoch());
-    int z = qrand() % vertices.size();
-    qDebug() << "\tant(): z " << z << " size: " << vertices.size();
+void ACS::setup(Graph* g, quint64 seed)
+{
+    m_graph = g;
+    m_parameters = new ACSParameters(ACSParameters::instance());
+    m_distances.setGraph(g);
+    m_colony = NULL;
+    m_localSearch = NULL;
+    m_observer = NULL;
+    m_cancel = NULL;
+    m_seed = seed;
+    m_iteration = 0;
+    m_lastImprovement = 0;
+    m_targetLength = -1;
+    m_targetReached = false;
+    // the solving thread's, the colonies of a MultiColonyACS are destroyed
+    // there
+    m_statsSink = StatsScope::current();
+//    int N = g->vertices().size();
+    if(m_parameters->localSearch() != LocalSearch::None)
+    {
+        m_localSearch = new LocalSearch(&m_distances);
+        m_localSearchTour.resize(m_distances.size());
+    }
+}
 
-    m_homeVertex = vertices.takeAt(z);
-    m_currentVertex = m_homeVertex;
-    m_remainingVertices = vertices;
-    m_ACSData = acsData;
-    m_tour = new Tour(m_homeVertex);
+ACS::~ACS()
+{
+    if(m_statsSink)
+    {
+        *m_statsSink += m_stats;
+    }
+    delete m_colony;
+    delete m_localSearch;
+    delete m_parameters;
 }
 
-Tour* Ant::tour()
+void ACS::setObserver(ACSObserver* observer)
 {
-    return m_tour;
+    m_observer = observer;
 }
 
-int Ant::tourLength()
+void ACS::setCancelToken(const CancelToken* cancel)
 {
-    return m_tour->length();
+    m_cancel = cancel;
 }
 
-void Ant::step()
+Tour* ACS::acs()
 {
-    if(!m_remainingVertices.empty())
+    init();
+    while(!isFinished())
     {
-		//qDebug() << "\t\tnot empty!";
-        double totalDesirability = 0;
-        QList< QPair<double, Vertex*> > toGo;
-
-        foreach(Vertex* v, m_remainingVertices)
-        {
-            double d = desirability(m_currentVertex->edgeTo(v));
-			//qDebug() << "\t\tdesirability: " << d;
-            toGo.append(QPair<double, Vertex*>(d, v));
-            totalDesirability += d;
-        }
-
-        double rand = ((double)qrand() / (double)RAND_MAX) * (double)totalDesirability;
+        iterate(1);
+    }
+    return &m_bestTour;
+}
 
-        bool stop = false;
-        double curr = 0;
-        int index = 0;
-		//qDebug() << "\trand: " << rand << " totalDesirability: " << totalDesirability;
-        while(!stop)
+// Runs up to "iterations" iterations, less if a stop criterion is met
+void ACS::iterate(int iterations)
+{
+    StatsScope scope(&m_stats);
+    for(int i = 0; i < iterations && !isFinished(); ++i)
+    {
+        Tour* temp = acsStep();
+        ++m_iteration;
+        if(m_bestTour.isEmpty() || temp->length() < m_bestTour.length())
         {
-			//qDebug() << "rand: " << rand << " curr: " << curr << " max: " << curr + toGo[index].first;
-            if(rand >= curr && rand < curr + toGo[index].first)
-            {
-				//qDebug() << "index: " << index << " size: " << toGo.size();
-
-                Vertex* v = toGo[index].second;
-                m_tour->addStep(m_currentVertex->edgeTo(v));
-                m_currentVertex = toGo[index].second;
-                m_remainingVertices.removeOne(v);
-                stop = true;
-            }
-            else
+            m_bestTour.assign(*temp);
+            m_lastImprovement = m_iteration;
+            checkTarget();
+            if(m_observer)
             {
-                curr += toGo[index].first;
-                ++index;                
+                m_observer->tourImproved(&m_bestTour, m_iteration);
             }
         }
+        m_colony->globalUpdate(temp, &m_bestTour);
+        bool improved = m_lastImprovement == m_iteration;
+        if(m_stats.trace.wants(m_iteration, improved))
+        {
+            recordSample(temp, improved);
+        }
+        if(m_observer)
+        {
+            m_observer->iterationFinished(m_iteration, m_bestTour.length());
+        }
     }
-    else
+}
+
+// Iteration limit, wall-clock budget and stagnation (iterations without
+// improvement of the best tour); a zero parameter disables the criterion,
+// with all of them disabled a single iteration is run
+bool ACS::isFinished() const
+{
+    const ACSParameters &params = *m_parameters;
+    if(m_cancel && m_cancel->isCanceled())
+    {
+        return true;
+    }
+    // refused by init()
+    if(!m_colony)
+    {
+        return true;
+    }
+    if(m_targetReached)
+    {
+        return true;
+    }
+    if(params.iterations() <= 0 && params.timeBudget() <= 0 && params.stagnationLimit() <= 0)
     {
-        //qDebug() << "\t\tempty!";
-        m_tour->addStep(m_currentVertex->edgeTo(m_homeVertex));
-        m_currentVertex = m_homeVertex;
+        return m_iteration >= 1;
     }
+    if(params.iterations() > 0 && m_iteration >= params.iterations())
+    {
+        return true;
+    }
+    if(params.timeBudget() > 0 && m_timer.elapsed() >= params.timeBudget())
+    {
+        return true;
+    }
+    if(params.stagnationLimit() > 0 && m_iteration - m_lastImprovement >= params.stagnationLimit())
+    {
+        return true;
+    }
+    return false;
 }
 
-void Ant::localUpdate()
+Tour* ACS::bestTour()
 {
-    Edge* e = lastStep();
-	double pheromoneUpdated = (1 - ACSParameters::instance().phi())*m_ACSData->pheromone(e) + (ACSParameters::instance().phi()*ACSParameters::instance().pheromoneZero());
-    m_ACSData->setPheromone(e, pheromoneUpdated);
+    return &m_bestTour;
 }
 
+// Migration: a better tour found by another colony becomes this colony's
+// best one and gets the deposit the colony's global update rule gives it
+void ACS::acceptTour(Tour* t)
+{
+    if(!m_bestTour.isEmpty() && m_bestTour.length() <= t->length())
+    {
+        return;
+    }
 
+    m_bestTour.assign(*t);
+    m_colony->acceptTour(&m_bestTour);
+    checkTarget();
+}
 
-double Ant::desirability(Edge* e)
+// After the global update, so that the branching factor describes the
+// trails the next iteration starts from
+void ACS::recordSample(Tour* iterationBest, bool improved)
 {
-    double a = m_ACSData->pheromone(e);
-	double b = qPow(1.0/(qreal)e->weight(), ACSParameters::instance().beta());
-    return a*b;
+    ConvergenceTrace::Sample sample;
+    sample.iteration = m_iteration;
+    sample.iterationBest = iterationBest->length();
+    sample.globalBest = m_bestTour.length();
+    qint64 total = 0;
+    for(int k = 0; k < m_colony->ants(); ++k)
+    {
+        total += m_colony->tour(k)->length();
+    }
+    sample.meanLength = double(total) / qMax(m_colony->ants(), 1);
+    sample.branchingFactor = ConvergenceTrace::branchingFactor(m_colony->data());
+    sample.msec = m_timer.nsecsElapsed() / 1e6;
+    sample.improved = improved;
+    m_stats.trace.append(sample);
 }
 
-Edge* Ant::lastStep()
+void ACS::checkTarget()
 {
-    return m_tour->last();
+    m_targetReached = m_targetLength >= 0 && !m_bestTour.isEmpty() && m_bestTour.length() <= m_targetLength;
 }
 
-void Ant::reset(QList<Vertex*> vertices)
+// init()
+//    For k:=1 to m do
+//        Let rk1 be the starting city for ant k
+//        Jk(rk1):= {1, ..., n} - rk1
+//        /* Jk(rk1) is the set of yet to be visited cities for
+//        ant k in city rk1 */
+//        rk:= rk1 /* rk is the city where ant k is located */
+//    End-fo
+void ACS::init()
 {
-    vertices.removeOne(m_homeVertex);
-    m_currentVertex = m_homeVertex;
-    m_remainingVertices = vertices;
-    m_tour = new Tour(m_homeVertex);
-}
+    StatsScope scope(&m_stats);
+    m_timer.start();
+    m_iteration = 0;
+    m_lastImprovement = 0;
+    m_targetLength = -1;
+    m_targetReached = false;
+    double targetGap = m_parameters->targetGap();
+    if(targetGap >= 0)
+    {
+        double bound = m_graph->lowerBound(m_cancel);
+        if(bound > 0)
+        {
+            // rounded up as tour lengths are integers, a gap of 0 stops at a
+            // proven optimum
+            m_targetLength = int(qFloor(bound * (1 + targetGap / 100) + 1 - 1e-9));
+        }
+    }
 
+    // Ants and trails of the configured ACO variant, each ant drawing from
+    // its own stream of the master seed
+    delete m_colony;
+    m_colony = NULL;
+    if(!m_distances.isDense())
+    {
+        GIS_WARNING(QString("ACS: %1 vertices are too many for the pheromone matrix").arg(m_distances.size()));
+        return;
+    }
+    ColonyParameters params = ColonyParameters::fromSettings(*m_parameters);
+    if(m_parameters->autoPheromoneZero() && m_distances.size() > 0)
+    {
+        // tau0 = 1 / (n Lnn) of the ACS paper
+        int nearestNeighbourLength = m_distances.tourLength(Construction::nearestNeighbour(&m_distances));
+        params.pheromoneZero = 1.0 / (m_distances.size() * qMax(nearestNeighbourLength, 1));
+    }
+    m_colony = createColony(&m_distances, params, m_seed);
+    // allocated here, not while iterating; nobody collects it without a sink
+    m_stats.trace.setCapacity(m_statsSink ? m_parameters->traceCapacity() : 0);
+    m_colony->setStats(&m_stats);
 
-ACS::ACS(Graph* g)
+    if(!m_warmStart.isEmpty())
+    {
+        applyWarmStart();
+        checkTarget();
+    }
+}
+
+void ACS::setWarmStart(const ACSSnapshot& snapshot)
 {
-    m_ACSData = new ACSData();
-    m_ACSData->setGraph(g);
-    m_graph = g;
-//    int N = g->vertices().size();
+    m_warmStart = snapshot;
 }
 
-Tour* ACS::acs()
+ACSSnapshot ACS::snapshot()
 {
-    init();
+    ACSSnapshot s;
+    if(!m_colony)
+    {
+        return s;
+    }
 
-    Tour* t = NULL;
-    int Lk = INT_MAX;
-    for(int i = 0; i < ITER_N; ++i)
+    int n = m_distances.size();
+    ACSData* data = m_colony->data();
+    s.distances.resize(n * n);
+    s.pheromones.resize(n * n);
+    for(int i = 0; i < n; ++i)
     {
-        Tour* temp = acsStep();
-        if(temp->length() < Lk)
+        s.labels.append(m_distances.vertex(i)->label());
+        for(int j = 0; j < n; ++j)
         {
-            t = temp;
-            Lk = temp->length();
+            s.distances[i * n + j] = m_distances.distance(i, j);
+            s.pheromones[i * n + j] = data->pheromone(i, j);
         }
-        globalUpdate();
     }
-    return t;
+    foreach(Vertex* v, m_bestTour.vertices())
+    {
+        s.bestTour.append(v->label());
+    }
+    return s;
 }
 
-// init()
-//    For k:=1 to m do
-//        Let rk1 be the starting city for ant k
-//        Jk(rk1):= {1, ..., n} - rk1
-//        /* Jk(rk1) is the set of yet to be visited cities for
-//        ant k in city rk1 */
-//        rk:= rk1 /* rk is the city where ant k is located */
-//    End-fo
-void ACS::init()
+void ACS::applyWarmStart()
 {
-    // Create Ants
-    for(int i = 0; i < m_ACSData->K; ++i)
+    const ACSSnapshot& s = m_warmStart;
+    int n = m_distances.size();
+    int oldN = s.labels.size();
+
+    // vertex index in this run -> index in the snapshot, -1 for new vertices
+    QHash<QString, int> oldIndices;
+    for(int i = 0; i < oldN; ++i)
+    {
+        oldIndices.insert(s.labels.at(i), i);
+    }
+    QVector<int> oldIndex(n);
+    for(int i = 0; i < n; ++i)
     {
-        QList<Vertex*> vl = m_graph->vertices();
-        Ant* a = new Ant(vl, m_ACSData);
-        m_ants.append(a);
+        oldIndex[i] = oldIndices.value(m_distances.vertex(i)->label(), -1);
+    }
+
+    ACSData* data = m_colony->data();
+    for(int i = 0; i < n; ++i)
+    {
+        int oi = oldIndex[i];
+        for(int j = 0; oi >= 0 && j < i; ++j)
+        {
+            int oj = oldIndex[j];
+            if(oj >= 0 && s.distances[oi * oldN + oj] == m_distances.distance(i, j))
+            {
+                data->setPheromone(i, j, s.pheromones[oi * oldN + oj]);
+            }
+        }
+    }
+
+    // old best tour without the removed vertices, the added ones go where
+    // they lengthen it least
+    QVector<int> tour;
+    QVector<bool> inTour(n, false);
+    foreach(const QString& label, s.bestTour)
+    {
+        Vertex* v = m_graph->vertex(label);
+        int i = v ? m_distances.indexOf(v) : -1;
+        if(i >= 0 && !inTour[i])
+        {
+            tour.append(i);
+            inTour[i] = true;
+        }
+    }
+    if(tour.isEmpty())
+    {
+        return;
+    }
+    for(int v = 0; v < n; ++v)
+    {
+        if(inTour[v])
+        {
+            continue;
+        }
+        int bestPos = tour.size();
+        int bestCost = INT_MAX;
+        for(int p = 0; p < tour.size(); ++p)
+        {
+            int a = tour[p];
+            int b = tour[(p + 1) % tour.size()];
+            int cost = m_distances.distance(a, v) + m_distances.distance(v, b) - m_distances.distance(a, b);
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestPos = p + 1;
+            }
+        }
+        tour.insert(bestPos, v);
+        inTour[v] = true;
+    }
+
+    m_bestTour.setSequence(tour, m_distances.tourLength(tour));
+    if(m_localSearch)
+    {
+        improveTour(&m_bestTour);
+    }
+    if(m_observer)
+    {
+        m_observer->tourImproved(&m_bestTour, 0);
     }
 }
 
@@ -309,70 +504,48 @@ void ACS::init()
 //    End-for
 Tour* ACS::acsStep()
 {
-    for(int i = 0; i < m_ACSData->N; ++i)
+    GIS_TIME_PHASE(&m_stats, AcsStep);
+    m_colony->constructTours();
+    improveTours();
+    return shortestTour();
+}
+
+// Local search on the constructed tours, before global updating:
+// either on every ant's tour or only on the iteration-best one
+void ACS::improveTours()
+{
+    if(!m_localSearch)
     {
-        for(int k = 0; k < m_ACSData->K; ++k)
-        {
-            m_ants[k]->step();
-        }
-        for(int k = 0; k < m_ACSData->K; ++k)
-        {
-            m_ants[k]->localUpdate();
-        }
+        return;
     }
 
-    int Lk = INT_MAX;
-    Tour* t = NULL;
-
-    for(int k = 0; k < m_ACSData->K; ++k)
+    if(m_parameters->localSearchAllAnts())
     {
-        if(Lk > m_ants[k]->tourLength())
+        for(int k = 0; k < m_colony->ants(); ++k)
         {
-            Lk = m_ants[k]->tourLength();
-            t = m_ants[k]->tour();
+            improveTour(m_colony->tour(k));
         }
-
-        m_ants[k]->reset(m_graph->vertices());
     }
-
-    return t;
+    else
+    {
+        improveTour(shortestTour());
+    }
 }
 
-// globalUpdate()
-//    For k:=1 to m do
-//        Compute Lk /* Lk is the length of the tour done by ant k*/
-//    End-for
-//    Compute Lbest
-//    /*Update edges belonging to Lbest using Eq. (4) */
-//    For each edge (r,s)
-//        t(rk ,sk):=(1-a)t( rk ,sk)+ a (Lbest)-1
-//    End-for
-void ACS::globalUpdate()
+void ACS::improveTour(Tour* t)
 {
-    int Lbest = INT_MAX;
-    Tour* tourBest = NULL;
-
-    // calculate best tour
-    for(int k = 0; k < m_ACSData->K; ++k)
+    const QVector<int> &seq = t->sequence();
+    int* dst = m_localSearchTour.data();
+    for(int i = 0; i < seq.size(); ++i)
     {
-        int Lk = m_ants[k]->tourLength();
-        if(Lk < Lbest)
-        {
-            Lbest = Lk;
-            tourBest = m_ants[k]->tour();
-        }
+        dst[i] = seq[i];
     }
 
-    // update pheromone
-    QList<Edge*> edges = m_ACSData->edges();
-
-    foreach(Edge* e, edges)
+    LocalSearch::Type type = (LocalSearch::Type)m_parameters->localSearch();
+    int length = m_localSearch->improve(m_localSearchTour, type);
+    if(length < t->length())
     {
-        m_ACSData->setPheromone(e, (1 - ALPHA)*m_ACSData->pheromone(e));
-        if(tourBest->contains(e))
-        {
-            m_ACSData->setPheromone(e,  m_ACSData->pheromone(e)+ 1/tourBest->length());
-        }
+        t->setSequence(m_localSearchTour, length);
     }
 }
 
@@ -381,13 +554,13 @@ Tour* ACS::shortestTour()
     int Lbest = INT_MAX;
     Tour* tourBest = NULL;
 
-    for(int k = 0; k < m_ACSData->K; ++k)
+    for(int k = 0; k < m_colony->ants(); ++k)
     {
-        int Lk = m_ants[k]->tourLength();
+        int Lk = m_colony->tour(k)->length();
         if(Lk < Lbest)
         {
             Lbest = Lk;
-            tourBest = m_ants[k]->tour();
+            tourBest = m_colony->tour(k);
         }
     }
 
@@ -397,59 +570,76 @@ Tour* ACS::shortestTour()
 
 
 
-struct BruteForceData {
-	BruteForceData() {}
-	QList<QList<Vertex *> > permutations;
-	void addElement(Vertex *v) {
-		if (permutations.isEmpty()) {
-			permutations.append(QList<Vertex *>() << v);
-			return;
-		}
-		if (permutations.size() == 1) {
-			permutations.append(permutations.first());
-			permutations.first().append(v);
-			permutations.last().prepend(v);
-			return;
-		}
-		int count = permutations.first().size() + 1;
-		QList<QList<Vertex *> > newPerms;
-		foreach (const QList<Vertex *> &perm, permutations) {
-			for (int i = 0; i < count; ++i) newPerms.append(perm);
-		}
+static const int infinity = 10000000;
+// milliseconds between the checks of a canceled caller of lowerBound()
+static const int LowerBoundPollInterval = 100;
 
-		bool dir = true;
-		for (int i = 0; i < newPerms.size(); ++i) {
-			int index = dir ? (count - (i % count) - 1) : (i % count);
-			newPerms[i].insert(index, v);
-			if (!index && dir) {
-				dir = false;
-			}
-			if (index == count - 1 && !dir) {
-				dir = true;
-			}
+// TSPLIB names of the EuclideanDistance types
+static const char *const euclideanTypeNames[] = { "EUC_2D", "CEIL_2D", "ATT" };
+
+static bool euclideanTypeFromName(const QString &name, EuclideanDistance::Type *type)
+{
+	for (int i = 0; i < 3; ++i) {
+		if (name == euclideanTypeNames[i]) {
+			*type = EuclideanDistance::Type(i);
+			return true;
 		}
-		permutations = newPerms;
 	}
-};
-
-bool pathLessThan(Path *p1, Path *p2) {
-	return p1->totalCost() < p2->totalCost();
+	return false;
 }
 
-static const int infinity = 10000000;
-
 /*!
 \class Graph
 */
 Graph::Graph()
-	: m_bfData(0)
+	: m_euclidean(false)
+	, m_euclideanType(EuclideanDistance::Euc2D)
+	, m_lowerBoundRunning(false)
+	, m_lowerBoundKnown(false)
+	, m_lowerBound(-1)
+	, m_lowerBoundGeneration(0)
+	, m_compressed(0)
+{
+}
+
+Graph::~Graph()
+{
+	clear();
+}
+
+void Graph::changed()
+{
+	{
+		QMutexLocker locker(&m_compressedMutex);
+		delete m_compressed;
+		m_compressed = 0;
+	}
+	QMutexLocker locker(&m_lowerBoundMutex);
+	m_lowerBoundKnown = false;
+	++m_lowerBoundGeneration;
+}
+
+const CompressedGraph *Graph::compressedEdges() const
 {
+	QMutexLocker locker(&m_compressedMutex);
+	if (!m_compressed) {
+		m_compressed = new CompressedGraph(this);
+	}
+	return m_compressed;
 }
 
 // Implementation of Floyd-Warshall algorithm
 void Graph::findShortestPaths()
 {
+	// complete already, and far too big for n^2 edges
+	if (m_euclidean) {
+		return;
+	}
+
+	GIS_CURRENT_STATS(stats);
+	GIS_TIME_PHASE(stats, ShortestPaths);
 	QList<QString> vertices_labels= m_vertices.keys();
+	GIS_COUNT(stats, Relaxations, qint64(vertices_labels.size()) * (vertices_labels.size() - 1) * (vertices_labels.size() - 2));
 
 	// init PI
 	foreach(QString label_i, vertices_labels)
@@ -498,6 +688,7 @@ void Graph::findShortestPaths()
 							else
                             {
 								vertex(label_i)->virtuallyConnectTo(vertex(label_j), d_ik_weight + d_kj_weight);
+								GIS_COUNT(stats, Allocations, 1);
 
                                 m_vertices[label_j]->setPrevious(label_i, m_vertices[label_j]->previous(label_k));
                                 m_vertices[label_i]->setPrevious(label_j, m_vertices[label_i]->previous(label_k));
@@ -564,6 +755,7 @@ Vertex *Graph::createVertex(const QString &label)
 
 	Vertex *vertex = new Vertex(this, label);
 	m_vertices.insert(label, vertex);
+	changed();
 
 	return vertex;
 }
@@ -578,6 +770,9 @@ bool Graph::isConnected() const
 	if (m_vertices.isEmpty()) {
 		return false;
 	}
+	if (m_euclidean) {
+		return true;
+	}
 	m_visited.clear();
 	dfsTraverseFrom(m_vertices.values().first());
 	if (m_vertices.values().size() == m_visited.size()) {
@@ -602,28 +797,53 @@ void Graph::dfsTraverseFrom(Vertex *v) const
 	}
 }
 
+bool Graph::load(const QString &filename)
+{
+	if (filename.endsWith(".tsp", Qt::CaseInsensitive)) {
+		return readTsplib(filename);
+	}
+	return readFromFile(filename);
+}
+
 bool Graph::readFromFile(const QString &filename)
 {
 	QFile file(filename);
 
 	if (!file.open(QFile::ReadOnly | QFile::Text)) {
-		qDebug("Cannot open file!");
+		GIS_DEBUG(QString("Cannot open %1").arg(filename));
 		return false;
 	}
 
 	QDomDocument doc;
 	if (!doc.setContent(&file)) {
-		qDebug("File content is not a well-formed XML");
+		GIS_DEBUG(QString("%1 is not well-formed XML").arg(filename));
 		return false;
 	}
 
-	// clear vertices
-	// TODO delete items
-	m_vertices.clear();
-	m_visited.clear();
+	clear();
 
 	// XML parsing
 	QDomElement rootElem = doc.documentElement();
+	EuclideanDistance::Type type = EuclideanDistance::Euc2D;
+	if (rootElem.hasAttribute("metric") && !euclideanTypeFromName(rootElem.attribute("metric"), &type)) {
+		return false;
+	}
+	for (QDomElement vertexElem = rootElem.firstChildElement("vertex"); !vertexElem.isNull(); vertexElem = vertexElem.nextSiblingElement("vertex")) {
+		Vertex *v = vertex(vertexElem.text());
+		if (!v) {
+			v = createVertex(vertexElem.text());
+		}
+		if (vertexElem.hasAttribute("x") || vertexElem.hasAttribute("y")) {
+			bool xOk = false;
+			bool yOk = false;
+			double x = vertexElem.attribute("x").toDouble(&xOk);
+			double y = vertexElem.attribute("y").toDouble(&yOk);
+			if (!xOk || !yOk) {
+				return false;
+			}
+			v->setPosition(x, y);
+		}
+	}
 	for (QDomElement edgeElem = rootElem.firstChildElement("edge"); !edgeElem.isNull(); edgeElem = edgeElem.nextSiblingElement("edge")) {
 		QDomElement vertex1Elem = edgeElem.firstChildElement("vertex");
 		if (vertex1Elem.isNull()) {
@@ -654,6 +874,145 @@ bool Graph::readFromFile(const QString &filename)
 		}
 		v1->connectTo(v2, weight);
 	}
+	updateEuclidean(type);
+	return true;
+}
+
+// Symmetric instances only. Vertices are labelled by their node numbers,
+// 1 to DIMENSION for explicit weights.
+bool Graph::readTsplib(const QString &filename)
+{
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly | QFile::Text)) {
+		GIS_DEBUG(QString("Cannot open %1").arg(filename));
+		return false;
+	}
+
+	clear();
+
+	QTextStream stream(&file);
+	int dimension = -1;
+	QString weightType;
+	QString weightFormat;
+	while (!stream.atEnd()) {
+		QString line = stream.readLine().trimmed();
+		if (line.isEmpty()) {
+			continue;
+		}
+		if (line == "EOF") {
+			break;
+		}
+		if (line.startsWith("NODE_COORD_SECTION") || line.startsWith("DISPLAY_DATA_SECTION")) {
+			for (int i = 0; i < dimension; ++i) {
+				QString label;
+				double x = 0;
+				double y = 0;
+				stream >> label >> x >> y;
+				if (stream.status() != QTextStream::Ok) {
+					return false;
+				}
+				Vertex *v = vertex(label);
+				if (!v) {
+					v = createVertex(label);
+				}
+				v->setPosition(x, y);
+			}
+			continue;
+		}
+		if (line.startsWith("EDGE_WEIGHT_SECTION")) {
+			if (weightType != "EXPLICIT" || dimension < 0 || !readTsplibWeights(stream, dimension, weightFormat)) {
+				return false;
+			}
+			continue;
+		}
+		if (line.endsWith("_SECTION")) {
+			GIS_DEBUG("Unsupported TSPLIB section " + line);
+			return false;
+		}
+
+		int colon = line.indexOf(':');
+		QString key = line.left(colon).trimmed();
+		QString value = colon < 0 ? QString() : line.mid(colon + 1).trimmed();
+		if (key == "TYPE" && value != "TSP") {
+			GIS_DEBUG("Unsupported TSPLIB problem type " + value);
+			return false;
+		} else if (key == "DIMENSION") {
+			dimension = value.toInt();
+		} else if (key == "EDGE_WEIGHT_TYPE") {
+			weightType = value;
+			EuclideanDistance::Type type;
+			if (weightType != "EXPLICIT" && !euclideanTypeFromName(weightType, &type)) {
+				GIS_DEBUG("Unsupported TSPLIB edge weight type " + value);
+				return false;
+			}
+		} else if (key == "EDGE_WEIGHT_FORMAT") {
+			weightFormat = value;
+		}
+	}
+
+	if (dimension <= 0 || m_vertices.size() != dimension) {
+		return false;
+	}
+	EuclideanDistance::Type type = EuclideanDistance::Euc2D;
+	if (weightType != "EXPLICIT") {
+		if (!euclideanTypeFromName(weightType, &type)) {
+			return false;
+		}
+		updateEuclidean(type);
+		return m_euclidean;
+	}
+	return true;
+}
+
+// The column formats of a symmetric matrix list the same numbers as the
+// transposed row formats
+bool Graph::readTsplibWeights(QTextStream &stream, int dimension, const QString &format)
+{
+	QString rowFormat = format;
+	if (format == "UPPER_COL") {
+		rowFormat = "LOWER_ROW";
+	} else if (format == "LOWER_COL") {
+		rowFormat = "UPPER_ROW";
+	} else if (format == "UPPER_DIAG_COL") {
+		rowFormat = "LOWER_DIAG_ROW";
+	} else if (format == "LOWER_DIAG_COL") {
+		rowFormat = "UPPER_DIAG_ROW";
+	}
+
+	QVector<Vertex *> verts(dimension);
+	for (int i = 0; i < dimension; ++i) {
+		QString label = QString::number(i + 1);
+		verts[i] = vertex(label);
+		if (!verts.at(i)) {
+			verts[i] = createVertex(label);
+		}
+	}
+	for (int i = 0; i < dimension; ++i) {
+		int first = 0;
+		int last = dimension;
+		if (rowFormat == "UPPER_ROW") {
+			first = i + 1;
+		} else if (rowFormat == "UPPER_DIAG_ROW") {
+			first = i;
+		} else if (rowFormat == "LOWER_ROW") {
+			last = i;
+		} else if (rowFormat == "LOWER_DIAG_ROW") {
+			last = i + 1;
+		} else if (rowFormat != "FULL_MATRIX") {
+			GIS_DEBUG("Unsupported TSPLIB edge weight format " + format);
+			return false;
+		}
+		for (int j = first; j < last; ++j) {
+			int weight = 0;
+			stream >> weight;
+			if (stream.status() != QTextStream::Ok) {
+				return false;
+			}
+			if (i != j && !verts.at(i)->edgeTo(verts.at(j))) {
+				verts.at(i)->connectTo(verts.at(j), weight);
+			}
+		}
+	}
 	return true;
 }
 
@@ -661,7 +1020,7 @@ bool Graph::saveToFile(const QString &filename) const
 {
 	QFile file(filename);
 	if (!file.open(QFile::WriteOnly | QFile::Text | QFile::Truncate)) {
-		qWarning("Cannot open file!");
+		GIS_WARNING(QString("Cannot open %1").arg(filename));
 		return false;
 	}
 	QSet<Edge *> set;
@@ -677,6 +1036,19 @@ bool Graph::saveToFile(const QString &filename) const
 	doc.setContent(QString("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
 						   "<graph></graph>"));
 	QDomElement graphElem = doc.documentElement();
+	if (m_euclidean) {
+		graphElem.setAttribute("metric", euclideanTypeNames[m_euclideanType]);
+	}
+	foreach (Vertex *v, verts) {
+		if (!v->hasPosition()) {
+			continue;
+		}
+		QDomElement vElem = doc.createElement("vertex");
+		vElem.setAttribute("x", QString::number(v->x(), 'g', 17));
+		vElem.setAttribute("y", QString::number(v->y(), 'g', 17));
+		vElem.appendChild(doc.createTextNode(v->label()));
+		graphElem.appendChild(vElem);
+	}
 	foreach (Edge *edge, set) {
 		QDomElement edgeElem = doc.createElement("edge");
 		QDomElement vElem = doc.createElement("vertex");
@@ -700,70 +1072,457 @@ bool Graph::saveToFile(const QString &filename) const
 	return true;
 }
 
-Path *Graph::tspPath(TspType type) const
+void Graph::clear()
+{
+	QSet<Edge *> edges;
+	foreach (Vertex *v, m_vertices) {
+		foreach (Edge *e, v->m_connectedVertices) {
+			edges.insert(e);
+		}
+	}
+	qDeleteAll(edges);
+	qDeleteAll(m_vertices);
+	m_vertices.clear();
+	m_visited.clear();
+	m_euclidean = false;
+	changed();
+}
+
+void Graph::updateEuclidean(EuclideanDistance::Type type)
+{
+	m_euclideanType = type;
+	m_euclidean = !m_vertices.isEmpty();
+	foreach (Vertex *v, m_vertices) {
+		if (!v->hasPosition() || !v->m_connectedVertices.isEmpty()) {
+			m_euclidean = false;
+			break;
+		}
+	}
+	changed();
+}
+
+bool Graph::isEuclidean() const
+{
+	return m_euclidean;
+}
+
+EuclideanDistance::Type Graph::euclideanType() const
+{
+	return m_euclideanType;
+}
+
+int Graph::euclideanDistance(Vertex *v1, Vertex *v2) const
+{
+	return EuclideanDistance::weight(m_euclideanType, v1->x() - v2->x(), v1->y() - v2->y());
+}
+
+Path *Graph::tspPath(TspType type, ACSObserver *observer, const CancelToken *cancel) const
 {
 	if (!m_vertices.size()) {
-		qDebug() << Q_FUNC_INFO << "Graph is empty!";
+		GIS_DEBUG(QString("%1: Graph is empty!").arg(Q_FUNC_INFO));
 		return 0;
 	}
 
+	Path *shortest = 0;
 	switch (type) {
 	case BruteForce:
-		return const_cast<Graph *>(this)->tspPath_BruteForce()->getFullPath();
+		shortest = const_cast<Graph *>(this)->tspPath_BruteForce(cancel);
+		break;
+	case BranchAndBound:
+		shortest = const_cast<Graph *>(this)->tspPath_BranchAndBound(cancel);
+		break;
+	case HeldKarp:
+		shortest = const_cast<Graph *>(this)->tspPath_HeldKarp(cancel);
+		break;
+	case NearestNeighbour:
+	case GreedyEdge:
+	case FarthestInsertion:
+	case CheapestInsertion:
+	case SpaceFillingCurve:
+		shortest = const_cast<Graph *>(this)->tspPath_Construction(type);
+		break;
+	case IteratedLocalSearch:
+		shortest = const_cast<Graph *>(this)->tspPath_IteratedLocalSearch(cancel);
+		break;
 	case ACS:
-		return const_cast<Graph *>(this)->tspPath_ACS();
+		return const_cast<Graph *>(this)->tspPath_ACS(observer, cancel);
+	}
+	if (!shortest) {
+		return 0;
 	}
 
-	return 0;
+	Path *full = shortest->getFullPath();
+	delete shortest;
+	return full;
 }
 
-Path* Graph::tspPath_ACS()
+// The solver runs on a graph of the required vertices only, whose edges are
+// the shortest paths between them (see MetricClosure); every step of its tour
+// is then expanded to the edges of this graph
+Path *Graph::tspPathThrough(const QList<Vertex *> &required, TspType type, ACSObserver *observer, const CancelToken *cancel) const
 {
-    GIS::ACS* a = new GIS::ACS(this);
-    Tour* t = a->acs();
-    return t->toFullPath();
+	QList<Vertex *> terminals;
+	foreach (Vertex *v, required) {
+		if (v && v->graph() == this && !terminals.contains(v)) {
+			terminals.append(v);
+		}
+	}
+	if (terminals.isEmpty()) {
+		GIS_DEBUG(QString("%1: No required vertices!").arg(Q_FUNC_INFO));
+		return 0;
+	}
+	if (terminals.size() == 1) {
+		Path *path = new Path(const_cast<Graph *>(this));
+		path->appendVertex(terminals.first());
+		return path;
+	}
+
+	MetricClosure closure(this, terminals);
+	closure.setCancelToken(cancel);
+	if (!closure.run()) {
+		return 0;
+	}
+
+	Graph stops;
+	QVector<Vertex *> stopVertices(closure.size());
+	QHash<Vertex *, int> indices;
+	for (int i = 0; i < closure.size(); ++i) {
+		Vertex *t = closure.terminal(i);
+		stopVertices[i] = stops.createVertex(t->label());
+		if (t->hasPosition()) {
+			stopVertices[i]->setPosition(t->x(), t->y());
+		}
+		indices.insert(stopVertices.at(i), i);
+	}
+	if (m_euclidean) {
+		stops.updateEuclidean(m_euclideanType);
+	} else {
+		// the closure is metric, so every edge is a shortest path and is its
+		// own expansion; this is what findShortestPaths() would find
+		for (int i = 0; i < closure.size(); ++i) {
+			for (int j = 0; j < closure.size(); ++j) {
+				if (i != j && closure.distance(i, j) < DistanceMatrix::Infinity) {
+					if (i < j) {
+						stopVertices.at(i)->connectTo(stopVertices.at(j), closure.distance(i, j));
+					}
+					stopVertices.at(j)->setPrevious(stopVertices.at(i)->label(), stopVertices.at(i));
+				}
+			}
+		}
+	}
+	QStringList initial;
+	foreach (const QString &label, initialTourLabels()) {
+		if (stops.vertex(label)) {
+			initial.append(label);
+		}
+	}
+	stops.setInitialTour(initial);
+
+	Path *tour = stops.tspPath(type, observer, cancel);
+	if (!tour) {
+		return 0;
+	}
+	QList<Vertex *> steps = tour->vertices();
+	Path *path = new Path(const_cast<Graph *>(this));
+	path->appendVertex(closure.terminal(indices.value(steps.first())));
+	for (int s = 1; s < steps.size(); ++s) {
+		QList<Vertex *> leg = closure.path(indices.value(steps.at(s - 1)), indices.value(steps.at(s)));
+		for (int i = 1; i < leg.size(); ++i) {
+			path->appendVertex(leg.at(i));
+		}
+	}
+	delete tour;
+	return path;
 }
 
-Path *Graph::tspPath_BruteForce()
+Path* Graph::tspPath_ACS(ACSObserver *observer, const CancelToken *cancel)
+{
+    // the pheromone and heuristic matrices are dense
+    if(!DistanceMatrix::isDenseGraph(this))
+    {
+        ACSLogger::instance().log(QString("%1 vertices are too many for the pheromone matrix").arg(m_vertices.size()));
+        return 0;
+    }
+    const ACSParameters &params = ACSParameters::instance();
+    if(params.colonies() > 1)
+    {
+        MultiColonyACS islands(this, params.colonies(), params.seed());
+        islands.setObserver(observer);
+        islands.setCancelToken(cancel);
+        islands.setWarmStart(acsWarmStart());
+        Tour* t = islands.acs(params.migrationInterval(), (MultiColonyACS::Topology)params.migrationTopology());
+        setAcsSnapshot(islands.snapshot());
+        return t->isEmpty() ? 0 : t->toFullPath();
+    }
+
+    GIS::ACS a(this);
+    a.setObserver(observer);
+    a.setCancelToken(cancel);
+    a.setWarmStart(acsWarmStart());
+    Tour* t = a.acs();
+    setAcsSnapshot(a.snapshot());
+    return t->isEmpty() ? 0 : t->toFullPath();
+}
+
+ACSSnapshot Graph::acsSnapshot() const
+{
+	QMutexLocker locker(&m_stateMutex);
+	return m_acsSnapshot;
+}
+
+void Graph::setAcsSnapshot(const ACSSnapshot &snapshot)
+{
+	QMutexLocker locker(&m_stateMutex);
+	m_acsSnapshot = snapshot;
+}
+
+void Graph::setAcsWarmStart(const ACSSnapshot &snapshot)
+{
+	QMutexLocker locker(&m_stateMutex);
+	m_acsWarmStart = snapshot;
+}
+
+ACSSnapshot Graph::acsWarmStart() const
+{
+	QMutexLocker locker(&m_stateMutex);
+	return m_acsWarmStart;
+}
+
+void Graph::setInitialTour(const QStringList &labels)
+{
+	QMutexLocker locker(&m_stateMutex);
+	m_initialTour = labels;
+}
+
+QStringList Graph::initialTourLabels() const
+{
+	QMutexLocker locker(&m_stateMutex);
+	return m_initialTour;
+}
+
+// One caller runs the ascent without the lock, the others wait for its
+// result rather than repeating it
+double Graph::lowerBound(const CancelToken *cancel) const
+{
+	QMutexLocker locker(&m_lowerBoundMutex);
+	while (m_lowerBoundRunning) {
+		if (cancel && cancel->isCanceled()) {
+			return -1;
+		}
+		m_lowerBoundDone.wait(&m_lowerBoundMutex, LowerBoundPollInterval);
+	}
+	if (m_lowerBoundKnown) {
+		return m_lowerBound;
+	}
+	m_lowerBoundRunning = true;
+	int generation = m_lowerBoundGeneration;
+	locker.unlock();
+
+	double result = -1;
+	bool known = true;
+	DistanceMatrix distances(this);
+	if (distances.isDense() && !distances.hasMissingEdges()) {
+		LowerBound bound(&distances);
+		bound.setCancelToken(cancel);
+		known = bound.run();
+		if (known) {
+			result = bound.bound();
+		}
+	}
+
+	locker.relock();
+	m_lowerBoundRunning = false;
+	if (known && generation == m_lowerBoundGeneration) {
+		m_lowerBoundKnown = true;
+		m_lowerBound = result;
+	}
+	m_lowerBoundDone.wakeAll();
+	return result;
+}
+
+QStringList Graph::lastTour() const
+{
+	QMutexLocker locker(&m_stateMutex);
+	return m_lastTour;
+}
+
+// DistanceMatrix indices of the initial tour, empty if it does not visit
+// every vertex once
+QVector<int> Graph::initialTour(const DistanceMatrix &distances) const
+{
+	QStringList labels = initialTourLabels();
+	QVector<int> tour;
+	if (labels.size() != distances.size()) {
+		return tour;
+	}
+	QVector<bool> visited(distances.size(), false);
+	foreach (const QString &label, labels) {
+		int v = distances.indexOf(vertex(label));
+		if (v < 0 || visited.at(v)) {
+			return QVector<int>();
+		}
+		visited[v] = true;
+		tour.append(v);
+	}
+	return tour;
+}
+
+Path *Graph::tspPath_BruteForce(const CancelToken *cancel)
 {
 	BFLogger::instance().log("-------------------------------");
 	BFLogger::instance().log("Starting brute force...");
-	if (m_bfData) {
-		delete m_bfData;
-	}
+	QElapsedTimer timer;
+	timer.start();
 
-	m_bfData = new BruteForceData;
-	BFLogger::instance().log("Creating all permutations...");
-	foreach (Vertex *v, m_vertices.values()) {
-		m_bfData->addElement(v);
+	DistanceMatrix distances(this);
+	if (!distances.isDense()) {
+		BFLogger::instance().log(QString("%1 vertices are too many").arg(distances.size()));
+		return 0;
+	}
+	BruteForceSearch search(&distances);
+	search.setCancelToken(cancel);
+	if (!search.run()) {
+		BFLogger::instance().log("CANCELED");
+		return 0;
 	}
+	BFLogger::instance().log(QString("Evaluated %1 tours in %2 ms").arg(search.tours()).arg(timer.elapsed()));
+	if (search.bestTour().isEmpty()) {
+		BFLogger::instance().log("No tour found");
+		return 0;
+	}
+	BFLogger::instance().log("DONE");
 
+	return closedPath(distances, search.bestTour());
+}
+
+Path *Graph::tspPath_BranchAndBound(const CancelToken *cancel)
+{
+	BFLogger::instance().log("-------------------------------");
+	BFLogger::instance().log("Starting branch and bound...");
+	QElapsedTimer timer;
+	timer.start();
+
+	DistanceMatrix distances(this);
+	if (!distances.isDense()) {
+		BFLogger::instance().log(QString("%1 vertices are too many").arg(distances.size()));
+		return 0;
+	}
+	GIS::BranchAndBound search(&distances);
+	search.setCancelToken(cancel);
+	search.setInitialTour(initialTour(distances));
+	if (!search.run()) {
+		BFLogger::instance().log("CANCELED");
+		return 0;
+	}
+	BFLogger::instance().log(QString("Initial tour: %1, root bound: %2").arg(search.initialLength()).arg(search.rootBound(), 0, 'f', 2));
+	BFLogger::instance().log(QString("Expanded %1 nodes in %2 ms").arg(search.nodes()).arg(timer.elapsed()));
+	if (search.bestTour().isEmpty()) {
+		BFLogger::instance().log("No tour found");
+		return 0;
+	}
 	BFLogger::instance().log("DONE");
-	BFLogger::instance().log("Making every permutation a path with end vertex same as start vertex...");
-	QList<Path *> paths;
-	foreach (const QList<Vertex *> &perm, m_bfData->permutations) {
-		Path *path = new Path(this);
-		foreach (Vertex *v, perm) {
-			path->appendVertex(v);
-		}
-		path->appendVertex(perm.first());
-		paths.append(path);
+
+	return closedPath(distances, search.bestTour());
+}
+
+Path *Graph::tspPath_HeldKarp(const CancelToken *cancel)
+{
+	BFLogger::instance().log("-------------------------------");
+	BFLogger::instance().log("Starting Held-Karp...");
+	qint64 required = GIS::HeldKarp::memoryRequired(m_vertices.size());
+	qint64 budget = qint64(ExactParameters::instance().memoryBudget()) << 20;
+	if (required < 0 || required > budget) {
+		BFLogger::instance().log(QString("%1 vertices need %2 MB, the memory budget is %3 MB")
+								 .arg(m_vertices.size())
+								 .arg(required < 0 ? QString("too much") : QString::number(required >> 20))
+								 .arg(budget >> 20));
+		return 0;
+	}
+	BFLogger::instance().log(QString("Tables take %1 MB").arg(double(required) / (1 << 20), 0, 'f', 1));
+	QElapsedTimer timer;
+	timer.start();
+
+	DistanceMatrix distances(this);
+	GIS::HeldKarp search(&distances);
+	search.setCancelToken(cancel);
+	if (!search.run()) {
+		BFLogger::instance().log("CANCELED");
+		return 0;
+	}
+	BFLogger::instance().log(QString("Solved in %1 ms").arg(timer.elapsed()));
+	if (search.bestTour().isEmpty()) {
+		BFLogger::instance().log("No tour found");
+		return 0;
 	}
 	BFLogger::instance().log("DONE");
-	BFLogger::instance().log("Searching for the shortest path...");
-	Path *shortest = 0;
-	for (QList<Path *>::iterator it = paths.begin(); it != paths.end(); ++it) {
-		if (!shortest) {
-			shortest = *it;
-			continue;
-		}
-		if ((*it)->totalCost() < shortest->totalCost()) {
-			shortest = *it;
-		}
+
+	return closedPath(distances, search.bestTour());
+}
+
+Path *Graph::tspPath_Construction(TspType type)
+{
+	static const char *const names[] = { "nearest neighbour", "greedy edge", "farthest insertion", "cheapest insertion", "space-filling curve" };
+	Construction::Method method = Construction::Method(type - NearestNeighbour);
+	BFLogger::instance().log("-------------------------------");
+	BFLogger::instance().log(QString("Starting %1...").arg(names[method]));
+	QElapsedTimer timer;
+	timer.start();
+
+	DistanceMatrix distances(this);
+	if (method == Construction::SpaceFillingCurve && !distances.hasPositions()) {
+		BFLogger::instance().log("The graph is not Euclidean");
+		return 0;
 	}
+	QVector<int> tour = Construction::tour(&distances, method);
+	BFLogger::instance().log(QString("Tour of length %1 in %2 ms").arg(distances.tourLength(tour)).arg(timer.elapsed()));
 	BFLogger::instance().log("DONE");
 
-	return shortest;
+	return closedPath(distances, tour);
+}
+
+Path *Graph::tspPath_IteratedLocalSearch(const CancelToken *cancel)
+{
+	BFLogger::instance().log("-------------------------------");
+	BFLogger::instance().log("Starting iterated local search...");
+	QElapsedTimer timer;
+	timer.start();
+
+	DistanceMatrix distances(this);
+	QVector<int> tour = initialTour(distances);
+	if (tour.isEmpty() && distances.hasPositions()) {
+		BFLogger::instance().log("Starting from the space-filling curve tour");
+		tour = Construction::spaceFillingCurve(&distances);
+	} else if (tour.isEmpty()) {
+		BFLogger::instance().log("Starting from the nearest neighbour tour");
+		tour = Construction::nearestNeighbour(&distances);
+	}
+	GIS::IteratedLocalSearch search(&distances);
+	search.setCancelToken(cancel);
+	search.setTimeLimit(ExactParameters::instance().improvementTimeLimit() * 1000);
+	search.setSeed(ACSParameters::instance().seed());
+	bool finished = search.run(tour);
+	BFLogger::instance().log(QString("Initial tour: %1, local optimum: %2").arg(search.initialLength()).arg(search.localOptimumLength()));
+	BFLogger::instance().log(QString("Tour of length %1 after %2 kicks (%3 improving) in %4 ms")
+							 .arg(search.bestLength()).arg(search.kicks()).arg(search.improvingKicks()).arg(timer.elapsed()));
+	BFLogger::instance().log(finished ? "DONE" : "CANCELED");
+
+	return closedPath(distances, search.bestTour());
+}
+
+// Path through the given DistanceMatrix indices and back to the first one
+Path *Graph::closedPath(const DistanceMatrix &distances, const QVector<int> &tour)
+{
+	Path *path = new Path(this);
+	QStringList labels;
+	foreach (int v, tour) {
+		path->appendVertex(distances.vertex(v));
+		labels.append(distances.vertex(v)->label());
+	}
+	path->appendVertex(distances.vertex(tour.first()));
+
+	QMutexLocker locker(&m_stateMutex);
+	m_lastTour = labels;
+	return path;
 }
 
 /*!
@@ -772,6 +1531,9 @@ Path *Graph::tspPath_BruteForce()
 Vertex::Vertex(Graph *parentGraph, const QString &label)
 	: m_graph(parentGraph)
 	, m_label(label)
+	, m_x(0)
+	, m_y(0)
+	, m_hasPosition(false)
 {
 }
 
@@ -809,6 +1571,7 @@ Edge *Vertex::connectTo(Vertex *v, int weight)
 	Edge *edge = new Edge(m_graph, this, v, weight);
 	m_connectedVertices.insert(v, edge);
 	v->m_connectedVertices.insert(this, edge);
+	m_graph->changed();
 	return edge;
 }
 
@@ -819,9 +1582,10 @@ Edge* Vertex::virtuallyConnectTo(Vertex *v, int weight)
 	return e;
 }
 
+// Does not insert, so that solves may share the graph
 Vertex* Vertex::previous(const QString &from)
 {
-	return m_previous[from];
+	return m_previous.value(from, 0);
 }
 
 void Vertex::setPrevious(const QString &from, Vertex* previous)
@@ -834,6 +1598,29 @@ QList<Edge *> Vertex::edges() const
 	return m_connectedVertices.values();
 }
 
+bool Vertex::hasPosition() const
+{
+	return m_hasPosition;
+}
+
+double Vertex::x() const
+{
+	return m_x;
+}
+
+double Vertex::y() const
+{
+	return m_y;
+}
+
+void Vertex::setPosition(double x, double y)
+{
+	m_x = x;
+	m_y = y;
+	m_hasPosition = true;
+	m_graph->changed();
+}
+
 /*!
 \class Edge
 */
@@ -868,12 +1655,18 @@ bool Edge::isVirtual() const
 
 void Edge::setWeight(int weight)
 {
-	m_weight = weight;
+	if (weight != m_weight) {
+		m_weight = weight;
+		m_graph->changed();
+	}
 }
 
 void Edge::turnToVirtual()
 {
-	m_virtual= true;
+	if (!m_virtual) {
+		m_virtual = true;
+		m_graph->changed();
+	}
 }
 
 /*!
@@ -893,13 +1686,17 @@ bool Path::appendVertex(Vertex *v)
 	}
 	Vertex *prev = m_vertices.last();
     if (prev == v) {
-        qDebug("Cannot add same vertex in path just after itself");
+        GIS_DEBUG("Cannot add same vertex in path just after itself");
         return false;
     }
 	m_vertices.append(v);
     Edge *e = prev->edgeTo(v);
+    if (!e && m_graph && m_graph->isEuclidean()) {
+        m_total += m_graph->euclideanDistance(prev, v);
+        return true;
+    }
     if (!e) {
-        qDebug("No such edge!");
+        GIS_DEBUG("No such edge!");
         return false;
     }
     m_total += e->weight();
@@ -940,9 +1737,7 @@ QList<Vertex* > Path::getFullPathRecursive(Vertex* from, Vertex* to)
 {
     if(from->label() == to->label())
     {
-        Path *result_path = new Path();
-        //result_path->appendVertex(from);
-        return result_path->vertices();
+        return QList<Vertex* >();
     }
 
     if(to->previous(from->label()) != NULL)
@@ -957,6 +1752,18 @@ QList<Vertex* > Path::getFullPathRecursive(Vertex* from, Vertex* to)
 
 Path* Path::getFullPath()
 {
+    GIS_CURRENT_STATS(stats);
+    GIS_TIME_PHASE(stats, FullPath);
+    GIS_COUNT(stats, Allocations, 1);
+    // every step is a direct one
+    if(m_graph && m_graph->isEuclidean())
+    {
+        Path* result_path = new Path(m_graph);
+        result_path->m_vertices = m_vertices;
+        result_path->m_total = m_total;
+        return result_path;
+    }
+
     QList<Vertex*> vlist = vertices();
     QList<Vertex*> rlist;
 
@@ -967,9 +1774,14 @@ Path* Path::getFullPath()
         rlist.append(getFullPathRecursive(vlist[i], vlist[i+1]));
     }
 
-    foreach(Vertex* v, rlist)
+    if(GIS_LOG_ENABLED(Debug))
     {
-        qDebug() << v->label();
+        QStringList labels;
+        foreach(Vertex* v, rlist)
+        {
+            labels << v->label();
+        }
+        GIS_DEBUG("Full path: " + labels.join(" "));
     }
 
     Path* result_path = new Path(m_graph);
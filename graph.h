@@ -2,18 +2,32 @@
 #define GRAPH_H
 
 #include <QString>
+#include <QStringList>
 #include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+class QTextStream;
+class ACSParameters;
+
+#include "random.h"
+#include "distancematrix.h"
+#include "instrumentation.h"
 
 namespace GIS {
 
 class ACS;
-class Ant;
 class Graph;
 class Path;
 class Edge;
-class ACSData;
-class BruteForceData;
 class Tour;
+class LocalSearch;
+class ACSObserver;
+class AntColony;
+class CancelToken;
+struct CompressedGraph;
 
 class Vertex
 {
@@ -30,6 +44,11 @@ public:
 	void turnToVirtual();
 	Vertex* previous(const QString &from);
 	void setPrevious(const QString &from, Vertex* previous);
+	// Optional point in the plane, e.g. from TSPLIB NODE_COORD_SECTION
+	bool hasPosition() const;
+	double x() const;
+	double y() const;
+	void setPosition(double x, double y);
 
 	friend class Graph;
 private:
@@ -37,6 +56,9 @@ private:
 	Graph *m_graph;
 	QString m_label;
 	QHash<Vertex *, Edge *> m_connectedVertices;
+	double m_x;
+	double m_y;
+	bool m_hasPosition;
 };
 
 class Edge
@@ -70,7 +92,7 @@ private:
     QList<Vertex* > getFullPathRecursive(Vertex* from, Vertex* to);
 
 public:
-    Path(){}
+    Path() : m_graph(0), m_total(0) {}
     bool setVertices(const QList<Vertex *> &verts);
 	QList<Vertex *> vertices() const;
 	int totalCost() const;
@@ -78,21 +100,51 @@ public:
     Path* getFullPath();
 
 	friend class Graph;
+	friend class Tour;
 private:
 	Graph *m_graph;
 	QList<Vertex *> m_vertices;
 	int m_total;
 };
 
+// Pheromone trails and best tour of an ACS run, keyed by vertex label so
+// that they can seed a run on a modified graph (see ACS::setWarmStart())
+struct ACSSnapshot
+{
+    bool isEmpty() const { return labels.isEmpty(); }
+
+    QStringList labels;
+    // N x N, indexed like labels; the distances tell which edges changed
+    QVector<int> distances;
+    QVector<double> pheromones;
+    QStringList bestTour;
+};
+
 class Graph
 {
 public:
 	enum TspType {
 		BruteForce,
-		ACS
+		ACS,
+		// exact, meant for up to about 40 vertices
+		BranchAndBound,
+		// exact, up to about 26 vertices within ExactParameters::memoryBudget()
+		HeldKarp,
+		// construction heuristics (see Construction)
+		NearestNeighbour,
+		GreedyEdge,
+		FarthestInsertion,
+		CheapestInsertion,
+		// needs a Euclidean graph
+		SpaceFillingCurve,
+		// improves the initial tour (see setInitialTour()), or a nearest
+		// neighbour one (space-filling curve one if Euclidean), for
+		// ExactParameters::improvementTimeLimit()
+		IteratedLocalSearch
 	};
 
 	Graph();
+	~Graph();
 	Vertex *createVertex(const QString &label);
 	Vertex *vertex(const QString &label) const;
 	void findShortestPaths();
@@ -100,95 +152,201 @@ public:
 	void printGraph();
 	QList<Vertex *> vertices() const;
 	bool isConnected() const;
+	// TSPLIB for *.tsp, XML otherwise
+	bool load(const QString &filename);
 	bool readFromFile(const QString &filename);
+	// TSPLIB TSP file with NODE_COORD_SECTION (EUC_2D, CEIL_2D, ATT) or
+	// EXPLICIT weights
+	bool readTsplib(const QString &filename);
 	bool saveToFile(const QString &filename) const;
-
-	Path *tspPath(TspType type = BruteForce) const;
+	// Set by the readers for a file of positioned vertices and no edges. Such
+	// a graph is complete: its weights are the EuclideanDistance of the
+	// positions, computed when needed instead of stored as edges.
+	bool isEuclidean() const;
+	EuclideanDistance::Type euclideanType() const;
+	int euclideanDistance(Vertex *v1, Vertex *v2) const;
+
+	// Returns 0 if the graph is empty or the solve was canceled before
+	// finding a tour. Several solves may run on the graph at once, e.g. in a
+	// BatchSolver, as long as nothing modifies it.
+	Path *tspPath(TspType type = BruteForce, ACSObserver *observer = 0, const CancelToken *cancel = 0) const;
+	// Closed tour through the required vertices, which may pass any other
+	// vertex. Only the shortest paths among the required ones are computed
+	// (see MetricClosure), the solver runs on those. The initial tour's
+	// required vertices, in its order, are its initial tour.
+	Path *tspPathThrough(const QList<Vertex *> &required, TspType type = BruteForce, ACSObserver *observer = 0, const CancelToken *cancel = 0) const;
+	// State of the last ACS run on this graph
+	ACSSnapshot acsSnapshot() const;
+	// Seeds the following ACS runs, an empty snapshot gives a cold start
+	void setAcsWarmStart(const ACSSnapshot &snapshot);
+	// Upper bound for the branch and bound and start of the iterated local
+	// search, e.g. the best tour of an earlier run; ignored unless it visits
+	// every vertex once
+	void setInitialTour(const QStringList &labels);
+	// Held-Karp lower bound on the tour length (see LowerBound), kept until
+	// the graph changes. Safe from solver threads, which wait for one of
+	// them to compute it; -1 if canceled, if a pair of vertices has no edge
+	// or if the graph is too big for a dense DistanceMatrix.
+	double lowerBound(const CancelToken *cancel = 0) const;
+	// Tour found by the last solve other than ACS, without the paths between
+	// its vertices
+	QStringList lastTour() const;
+	// The real edges in compressed rows, built on first use and kept until
+	// the graph changes. Safe from solver threads.
+	const CompressedGraph *compressedEdges() const;
+
+	friend class GraphGenerator;
+	friend class Vertex;
+	friend class Edge;
 private:
+	// Drops what is derived from the vertices, their positions and the edges
+	void changed();
 	void dfsTraverseFrom(Vertex *v) const;
+	void clear();
+	void updateEuclidean(EuclideanDistance::Type type);
+	bool readTsplibWeights(QTextStream &stream, int dimension, const QString &format);
 	Edge* d(QString label_i, QString label_j);
-	Path *tspPath_BruteForce();
-	Path *tspPath_ACS();
+	Path *tspPath_BruteForce(const CancelToken *cancel);
+	Path *tspPath_BranchAndBound(const CancelToken *cancel);
+	Path *tspPath_HeldKarp(const CancelToken *cancel);
+	Path *tspPath_Construction(TspType type);
+	Path *tspPath_IteratedLocalSearch(const CancelToken *cancel);
+	QVector<int> initialTour(const DistanceMatrix &distances) const;
+	Path *closedPath(const DistanceMatrix &distances, const QVector<int> &tour);
+	Path *tspPath_ACS(ACSObserver *observer, const CancelToken *cancel);
+	void setAcsSnapshot(const ACSSnapshot &snapshot);
+	ACSSnapshot acsWarmStart() const;
+	QStringList initialTourLabels() const;
 private:
 	QHash<QString, Vertex *> m_vertices;
 	mutable QList<Vertex *> m_visited;
+	bool m_euclidean;
+	EuclideanDistance::Type m_euclideanType;
     //ACSData *m_acsData;
-	BruteForceData *m_bfData;
+	ACSSnapshot m_acsSnapshot;
+	ACSSnapshot m_acsWarmStart;
+	QStringList m_initialTour;
+	QStringList m_lastTour;
+	// guards the four members above
+	mutable QMutex m_stateMutex;
+	mutable QMutex m_lowerBoundMutex;
+	mutable QWaitCondition m_lowerBoundDone;
+	mutable bool m_lowerBoundRunning;
+	mutable bool m_lowerBoundKnown;
+	mutable double m_lowerBound;
+	// counts the changes, a bound computed across one is not kept
+	int m_lowerBoundGeneration;
+	mutable QMutex m_compressedMutex;
+	mutable CompressedGraph *m_compressed;
 };
 
-class ACS
+// Receives the best-so-far tour of a running ACS. Called from the solving
+// thread; the tour stays owned by the solver, so copy what you need.
+class ACSObserver
 {
-
 public:
-    ACS(Graph* g);
-    Tour *acs();
-
-private:
-
-    void init();
-    Tour* acsStep();
-    void globalUpdate();
-    Tour* shortestTour();
-
-    QList<Ant* > m_ants;
-    Graph* m_graph;
-    ACSData* m_ACSData;
-
-    //static const int ANT_N = 100;
-    static const int ITER_N = 5;
-    static const double ALPHA = 0.6;
+    virtual ~ACSObserver() {}
+    virtual void tourImproved(Tour* best, int iteration) = 0;
+    // After every iteration (every migration for MultiColonyACS)
+    virtual void iterationFinished(int iteration, int bestLength) { Q_UNUSED(iteration); Q_UNUSED(bestLength); }
 };
 
+// Closed tour as a sequence of DistanceMatrix indices, the start vertex is
+// not repeated at the end. The buffer is allocated on first use and then
+// reused, so resetting and refilling a tour does not allocate.
 class Tour
 {
 private:
-    QList<Edge* > m_tour;
-    double m_tourLength;
-    Vertex* m_startPoint;
+    const DistanceMatrix* m_distances;
+    QVector<int> m_sequence;
+    int m_size;
+    int m_tourLength;
 
 public:
-    //Tour();
-    Tour(Vertex* startPoint)
+    Tour(const DistanceMatrix* distances)
     {
-        m_startPoint = startPoint;
+        m_distances = distances;
+        m_size = 0;
+        m_tourLength = 0;
     }
 
-    void addStep(Edge* e);
-    bool contains(Edge* e);
+    void reset(int start);
+    void addStep(int v);
+    void close();
+    void assign(const Tour &other);
+    void setSequence(const QVector<int> &sequence, int length);
+    bool isEmpty();
+    int size();
+    const QVector<int> &sequence();
     Vertex* startPoint();
-    double length();
-    Edge* last();
+    int length();
+    QList<Vertex*> vertices();
     Path* toPath();
     Path* toFullPath();
 };
 
-class Ant
+// Drives an ACO run: stop criteria, local search, best tour and observer.
+// Tour construction and pheromone updates are done by the AntColony of the
+// variant chosen in ACSParameters (see colony.h).
+class ACS
 {
-public:
-
-    Ant(QList<Vertex*> vertices, ACSData* acsData);
-
-    Tour* tour();
-
-    int tourLength();
-
-    void step();
 
-    void reset(QList<Vertex*> vertices);
-
-    void localUpdate();
+public:
+    ACS(Graph* g);
+    ACS(Graph* g, quint64 seed);
+    ~ACS();
+    Tour *acs();
+    void setObserver(ACSObserver* observer);
+    // Stops the run at the next iteration once canceled
+    void setCancelToken(const CancelToken* cancel);
+    // Applied by init(): trails of edges that exist in the snapshot with the
+    // same length are restored, all others start at pheromoneZero; the
+    // snapshot's best tour, repaired for added and removed vertices, becomes
+    // the initial best tour
+    void setWarmStart(const ACSSnapshot& snapshot);
+    ACSSnapshot snapshot();
+
+    // Incremental use, e.g. by MultiColonyACS
+    void init();
+    void iterate(int iterations);
+    bool isFinished() const;
+    Tour* bestTour();
+    void acceptTour(Tour* t);
 
 private:
 
-    double desirability(Edge* e);
-
-    Edge* lastStep();
+    void setup(Graph* g, quint64 seed);
+    Tour* acsStep();
+    void improveTours();
+    void improveTour(Tour* t);
+    Tour* shortestTour();
+    void applyWarmStart();
+    void checkTarget();
+    void recordSample(Tour* iterationBest, bool improved);
 
-    Vertex* m_homeVertex;
-    Vertex* m_currentVertex;
-    QList<Vertex* > m_remainingVertices;
-    Tour* m_tour;
-    ACSData* m_ACSData;
+    Graph* m_graph;
+    // ACSParameters::instance() when constructed, so that the colonies of a
+    // MultiColonyACS run with their creator's parameters on any thread
+    ACSParameters* m_parameters;
+    AntColony* m_colony;
+    DistanceMatrix m_distances;
+    LocalSearch* m_localSearch;
+    QVector<int> m_localSearchTour;
+    Tour m_bestTour;
+    ACSObserver* m_observer;
+    const CancelToken* m_cancel;
+    ACSSnapshot m_warmStart;
+    quint64 m_seed;
+    int m_iteration;
+    int m_lastImprovement;
+    // ACSParameters::targetGap() as a length, -1 if off
+    int m_targetLength;
+    bool m_targetReached;
+    QElapsedTimer m_timer;
+    // Collected by this object, whatever thread runs it, and added to
+    // m_statsSink (the StatsScope of the creating thread) when destroyed
+    SolveStats m_stats;
+    SolveStats* m_statsSink;
 };
 
 } // namespace GIS
@@ -0,0 +1,65 @@
+#include "graphgenerator.h"
+#include "graph.h"
+#include "random.h"
+
+#include <QVector>
+
+namespace GIS {
+
+/*!
+\class GraphGenerator
+*/
+Graph *GraphGenerator::levelGraph(int vertices, int level, quint64 seed)
+{
+	if (level <= 0 || level >= vertices) {
+		return 0;
+	}
+	Graph *graph = new Graph;
+	Random random(seed);
+	QVector<Vertex *> created;
+	created.reserve(vertices);
+	QVector<int> chosen;
+	chosen.reserve(level);
+	for (int i = 0; i < vertices; ++i) {
+		Vertex *v = graph->createVertex(vertexName(i));
+		if (i >= level) {
+			// Floyd's sampling of `level` distinct earlier vertices
+			chosen.clear();
+			for (int j = i - level; j < i; ++j) {
+				int pick = random.nextInt(j + 1);
+				chosen.append(chosen.contains(pick) ? j : pick);
+			}
+			foreach (int pick, chosen) {
+				created.at(pick)->connectTo(v, random.nextInt(100) + 1);
+			}
+		}
+		created.append(v);
+	}
+	return graph;
+}
+
+Graph *GraphGenerator::euclideanGraph(int vertices, int side, quint64 seed, EuclideanDistance::Type type)
+{
+	Graph *graph = new Graph;
+	Random random(seed);
+	for (int i = 0; i < vertices; ++i) {
+		Vertex *v = graph->createVertex(vertexName(i));
+		double x = random.nextInt(side);
+		double y = random.nextInt(side);
+		v->setPosition(x, y);
+	}
+	graph->updateEuclidean(type);
+	return graph;
+}
+
+// Bijective base 26: A to Z, then AA to ZZ and so on
+QString GraphGenerator::vertexName(int index)
+{
+	QString name;
+	for (int n = index + 1; n > 0; n = (n - 1) / 26) {
+		name.prepend(QChar('A' + (n - 1) % 26));
+	}
+	return name;
+}
+
+} // namespace GIS
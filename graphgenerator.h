@@ -0,0 +1,34 @@
+#ifndef GRAPHGENERATOR_H
+#define GRAPHGENERATOR_H
+
+#include <QString>
+
+#include "euclideandistance.h"
+
+namespace GIS {
+
+class Graph;
+
+// Seeded random graphs for the generator dialog and the benchmarks; the
+// same arguments always give the same graph. Vertices are named A, B, ...,
+// Z, AA, AB, ... in the order of creation.
+class GraphGenerator
+{
+public:
+	// The first `level` vertices are not connected to each other, every
+	// further one gets edges of weight 1 to 100 to `level` distinct earlier
+	// ones. Connected, with about level * vertices edges. 0 unless
+	// 0 < level < vertices.
+	static Graph *levelGraph(int vertices, int level, quint64 seed);
+	// Vertices at uniform random integer positions in [0, side)^2, a
+	// Euclidean graph (see Graph::isEuclidean())
+	static Graph *euclideanGraph(int vertices, int side, quint64 seed,
+								 EuclideanDistance::Type type = EuclideanDistance::Euc2D);
+
+	// Name of the index-th vertex, counting from 0
+	static QString vertexName(int index);
+};
+
+} // namespace GIS
+
+#endif // GRAPHGENERATOR_H
@@ -16,17 +16,14 @@ public:
 public slots:
 	void generateGraph();
 	void saveGraph();
-private:
-	QString generateName();
-	void resetNameGenerator();
 private:
 	QSpinBox *m_vertSpinBox;
 	QSpinBox *m_lvlSpinBox;
+	QSpinBox *m_seedSpinBox;
 	QLabel *m_statusLabel;
 	QPushButton *m_generateButton;
 	QPushButton *m_saveButton;
 	GIS::Graph *m_graph;
-	char *m_currentName;
 };
 
 #endif // GRAPHGENERATORWIDGET_H
@@ -169,6 +169,9 @@ QVariant GraphModel::data(const QModelIndex &index, int role) const
 				return QVariant();
 			}
 			VertexItem *vi = static_cast<VertexItem *>(item);
+			if (vi->vertex->hasPosition()) {
+				return QString("Vertex \"%1\" (%2, %3)").arg(vi->vertex->label()).arg(vi->vertex->x()).arg(vi->vertex->y());
+			}
 			return QString("Vertex \"%1\"").arg(vi->vertex->label());
 		}
 	case Item::Edge:
@@ -0,0 +1,25 @@
+TEMPLATE = app
+TARGET = gis-acs
+OBJECTS_DIR = obj/gui
+
+QT += gui
+include(core.pri)
+
+HEADERS += \
+    graphmodel.h \
+    mainwindow.h \
+    solverthread.h \
+    graphgeneratorwidget.h
+
+SOURCES += \
+    solverthread.cpp \
+    main.cpp \
+    graphmodel.cpp \
+    mainwindow.cpp \
+    graphgeneratorwidget.cpp
+
+OTHER_FILES += \
+    test_short_paths.xml
+
+FORMS += \
+    mainwindow.ui
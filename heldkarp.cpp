@@ -0,0 +1,265 @@
+#include "heldkarp.h"
+#include "distancematrix.h"
+#include "canceltoken.h"
+
+#include <QtConcurrentMap>
+
+namespace GIS {
+
+// Sets per parallel task
+static const qint64 ChunkSize = 4096;
+
+// The tables are only read, or written at the chunk's own entries, through
+// pointers taken before the tasks start
+struct HeldKarpChunk {
+	typedef void result_type;
+	HeldKarpChunk(const HeldKarp *heldKarp, int k, int *lengths, quint8 *parents)
+		: heldKarp(heldKarp), k(k), lengths(lengths), parents(parents) {}
+	void operator()(const QPair<qint64, qint64> &range) const {
+		if (heldKarp->m_cancel && heldKarp->m_cancel->isCanceled()) {
+			return;
+		}
+		heldKarp->computeLayer(k, range.first, range.second, lengths, parents);
+	}
+	const HeldKarp *heldKarp;
+	int k;
+	int *lengths;
+	quint8 *parents;
+};
+
+static qint64 binomialCoefficient(int n, int k)
+{
+	if (k < 0 || k > n) {
+		return 0;
+	}
+	qint64 result = 1;
+	for (int i = 1; i <= k; ++i) {
+		result = result * (n - k + i) / i;
+	}
+	return result;
+}
+
+/*!
+\class HeldKarp
+*/
+const int HeldKarp::MaxVertices;
+
+HeldKarp::HeldKarp(const DistanceMatrix *distances)
+	: m_distances(distances)
+	, m_cancel(0)
+	, m_n(distances->size())
+	, m_m(qMax(m_n - 1, 0))
+	, m_bestLength(DistanceMatrix::Infinity)
+	, m_canceled(false)
+{
+}
+
+// Two adjacent layers of lengths plus the predecessors of all layers; a
+// single table is limited to 2 GB by QVector
+qint64 HeldKarp::memoryRequired(int vertices)
+{
+	if (vertices > MaxVertices) {
+		return -1;
+	}
+	int m = qMax(vertices - 1, 0);
+	qint64 lengths = 0;
+	qint64 parents = 0;
+	for (int k = 1; k <= m; ++k) {
+		qint64 entries = binomialCoefficient(m, k) * k;
+		qint64 previous = binomialCoefficient(m, k - 1) * (k - 1);
+		if (entries * qint64(sizeof(int)) > 0x7fffffff) {
+			return -1;
+		}
+		lengths = qMax(lengths, (entries + previous) * qint64(sizeof(int)));
+		parents += entries;
+	}
+	return lengths + parents;
+}
+
+void HeldKarp::setCancelToken(const CancelToken *cancel)
+{
+	m_cancel = cancel;
+}
+
+bool HeldKarp::run()
+{
+	m_bestTour.clear();
+	m_bestLength = DistanceMatrix::Infinity;
+	m_canceled = false;
+	if (m_n == 0 || memoryRequired(m_n) < 0) {
+		return true;
+	}
+	if (m_n == 1) {
+		m_bestTour.append(0);
+		m_bestLength = 0;
+		return true;
+	}
+
+	m_binomial.resize((m_m + 1) * (m_m + 1));
+	for (int n = 0; n <= m_m; ++n) {
+		for (int k = 0; k <= m_m; ++k) {
+			m_binomial[n * (m_m + 1) + k] = binomialCoefficient(n, k);
+		}
+	}
+	m_parents.clear();
+	m_parents.resize(m_m + 1);
+
+	// {j}: the edge from 0
+	m_current.resize(m_m);
+	m_parents[1].resize(m_m);
+	for (int v = 1; v < m_n; ++v) {
+		m_current[v - 1] = m_distances->distance(0, v);
+		m_parents[1][v - 1] = 0;
+	}
+
+	for (int k = 2; k <= m_m; ++k) {
+		qSwap(m_previous, m_current);
+		qint64 sets = binomial(m_m, k);
+		m_current.resize(int(sets * k));
+		m_parents[k].resize(int(sets * k));
+
+		QList<QPair<qint64, qint64> > chunks;
+		for (qint64 first = 0; first < sets; first += ChunkSize) {
+			chunks.append(qMakePair(first, qMin(first + ChunkSize, sets)));
+		}
+		QtConcurrent::blockingMap(chunks, HeldKarpChunk(this, k, m_current.data(), m_parents[k].data()));
+		if (m_cancel && m_cancel->isCanceled()) {
+			m_canceled = true;
+			m_previous.clear();
+			m_current.clear();
+			m_parents.clear();
+			return false;
+		}
+	}
+	m_previous.clear();
+
+	// close the tour from the full set
+	int last = -1;
+	for (int i = 0; i < m_m; ++i) {
+		int w = m_distances->distance(i + 1, 0);
+		if (m_current.at(i) < DistanceMatrix::Infinity && w < DistanceMatrix::Infinity
+				&& m_current.at(i) + w < m_bestLength) {
+			m_bestLength = m_current.at(i) + w;
+			last = i + 1;
+		}
+	}
+	m_current.clear();
+	if (last > 0) {
+		rebuildTour(last);
+	}
+	m_parents.clear();
+	return true;
+}
+
+// The k-set of the given colex rank: its largest element c is the largest
+// with binomial(c, k) <= rank
+quint32 HeldKarp::unrank(qint64 rank, int k) const
+{
+	quint32 set = 0;
+	int c = m_m - 1;
+	for (int i = k; i > 0; --i) {
+		while (binomial(c, i) > rank) {
+			--c;
+		}
+		set |= 1u << c;
+		rank -= binomial(c, i);
+		--c;
+	}
+	return set;
+}
+
+qint64 HeldKarp::rank(quint32 set) const
+{
+	qint64 result = 0;
+	int i = 0;
+	for (int c = 0; c < m_m; ++c) {
+		if (set & (1u << c)) {
+			result += binomial(c, ++i);
+		}
+	}
+	return result;
+}
+
+// C(S, j) = min over i in S - {j} of C(S - {j}, i) + d(i, j) for the sets
+// ranked [first, last) of size k. Removing the p-th element lowers the index
+// of every later element by one, so the rank of S - {j} is the rank terms of
+// the elements before p plus those after it with their index decremented.
+void HeldKarp::computeLayer(int k, qint64 first, qint64 last, int *lengths, quint8 *parents) const
+{
+	int elements[MaxVertices];
+	qint64 before[MaxVertices + 1];
+	qint64 after[MaxVertices + 1];
+	const int *previous = m_previous.constData();
+	int *current = lengths + first * k;
+	parents += first * k;
+
+	quint32 set = unrank(first, k);
+	for (qint64 r = first; r < last; ++r) {
+		int count = 0;
+		for (int c = 0; count < k; ++c) {
+			if (set & (1u << c)) {
+				elements[count++] = c;
+			}
+		}
+		before[0] = 0;
+		for (int p = 0; p < k; ++p) {
+			before[p + 1] = before[p] + binomial(elements[p], p + 1);
+		}
+		after[k] = 0;
+		for (int p = k - 1; p >= 0; --p) {
+			after[p] = after[p + 1] + (p > 0 ? binomial(elements[p], p) : 0);
+		}
+
+		for (int p = 0; p < k; ++p) {
+			int j = elements[p] + 1;
+			const int *toJ = m_distances->row(j);
+			const int *subset = previous + (before[p] + after[p + 1]) * (k - 1);
+			int best = DistanceMatrix::Infinity;
+			int bestParent = 0;
+			for (int q = 0; q < k; ++q) {
+				if (q == p) {
+					continue;
+				}
+				int i = elements[q] + 1;
+				int length = subset[q < p ? q : q - 1];
+				int w = toJ[i];
+				if (length < DistanceMatrix::Infinity && w < DistanceMatrix::Infinity && length + w < best) {
+					best = length + w;
+					bestParent = i;
+				}
+			}
+			current[p] = best;
+			parents[p] = bestParent;
+		}
+		current += k;
+		parents += k;
+
+		// next set of the same size in colex order (Gosper's hack)
+		quint32 lowest = set & -set;
+		quint32 ripple = set + lowest;
+		set = ripple | (((ripple ^ set) >> 2) / lowest);
+	}
+}
+
+// Walks the predecessors back from the full set
+void HeldKarp::rebuildTour(int last)
+{
+	m_bestTour.resize(m_n);
+	m_bestTour[0] = 0;
+	quint32 set = (1u << m_m) - 1;
+	int j = last;
+	for (int k = m_m; k > 0; --k) {
+		m_bestTour[k] = j;
+		int p = 0;
+		for (int c = 0; c < j - 1; ++c) {
+			if (set & (1u << c)) {
+				++p;
+			}
+		}
+		int parent = m_parents.at(k).at(rank(set) * k + p);
+		set &= ~(1u << (j - 1));
+		j = parent;
+	}
+}
+
+} // namespace GIS
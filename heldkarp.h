@@ -0,0 +1,68 @@
+#ifndef HELDKARP_H
+#define HELDKARP_H
+
+#include <QVector>
+
+namespace GIS {
+
+class DistanceMatrix;
+class CancelToken;
+struct HeldKarpChunk;
+
+// Exact TSP by the Held-Karp dynamic program: C(S, j) is the length of the
+// shortest path from vertex 0 through the set S ending in j. Sets of one size
+// form a layer computed from the previous one only, so just two layers of
+// lengths are kept; a set is stored at its colex rank among the sets of its
+// size, which is the order of the bitmasks. The predecessor of every entry is
+// kept (one byte each) to rebuild the tour. Every layer is split into chunks
+// computed in parallel.
+class HeldKarp
+{
+public:
+	// Sets are 31-bit masks of the vertices other than 0
+	static const int MaxVertices = 32;
+
+	HeldKarp(const DistanceMatrix *distances);
+
+	// Bytes of the tables for the given number of vertices, -1 if it is over
+	// MaxVertices or a layer would not fit in a QVector
+	static qint64 memoryRequired(int vertices);
+
+	void setCancelToken(const CancelToken *cancel);
+
+	// Returns false if canceled
+	bool run();
+
+	// Sequence of vertex indices starting with 0, empty if there is no tour
+	const QVector<int> &bestTour() const { return m_bestTour; }
+	int bestLength() const { return m_bestLength; }
+
+	friend struct HeldKarpChunk;
+
+private:
+	qint64 binomial(int n, int k) const { return m_binomial.at(n * (m_m + 1) + k); }
+	quint32 unrank(qint64 rank, int k) const;
+	qint64 rank(quint32 set) const;
+	void computeLayer(int k, qint64 first, qint64 last, int *lengths, quint8 *parents) const;
+	void rebuildTour(int last);
+
+	const DistanceMatrix *m_distances;
+	const CancelToken *m_cancel;
+	int m_n;
+	// vertices in the sets, vertex v is bit v - 1
+	int m_m;
+	QVector<qint64> m_binomial;
+	// lengths of the layers |S| = k - 1 and k, entry rank(S) * |S| + i for
+	// the i-th smallest vertex of S as j
+	QVector<int> m_previous;
+	QVector<int> m_current;
+	// predecessor of every entry of every layer
+	QVector<QVector<quint8> > m_parents;
+	QVector<int> m_bestTour;
+	int m_bestLength;
+	bool m_canceled;
+};
+
+} // namespace GIS
+
+#endif // HELDKARP_H
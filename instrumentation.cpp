@@ -0,0 +1,123 @@
+#include "instrumentation.h"
+
+#include <QThreadStorage>
+
+namespace GIS {
+
+static const char *const phaseNames[] = {
+	"shortestPaths", "acsStep", "antStep", "localUpdate", "globalUpdate", "fullPath"
+};
+
+static const char *const counterNames[] = {
+	"desirabilityEvaluations", "pheromoneWrites", "relaxations", "allocations"
+};
+
+/*!
+\class SolveStats
+*/
+void SolveStats::clear()
+{
+	for (int i = 0; i < PhaseCount; ++i) {
+		nsecs[i] = 0;
+		calls[i] = 0;
+	}
+	for (int i = 0; i < CounterCount; ++i) {
+		counters[i] = 0;
+	}
+	trace.clear();
+}
+
+bool SolveStats::isEmpty() const
+{
+	for (int i = 0; i < PhaseCount; ++i) {
+		if (calls[i]) {
+			return false;
+		}
+	}
+	for (int i = 0; i < CounterCount; ++i) {
+		if (counters[i]) {
+			return false;
+		}
+	}
+	return trace.isEmpty();
+}
+
+SolveStats &SolveStats::operator+=(const SolveStats &other)
+{
+	for (int i = 0; i < PhaseCount; ++i) {
+		nsecs[i] += other.nsecs[i];
+		calls[i] += other.calls[i];
+	}
+	for (int i = 0; i < CounterCount; ++i) {
+		counters[i] += other.counters[i];
+	}
+	if (!other.trace.isEmpty() && (trace.isEmpty() || other.trace.last().globalBest < trace.last().globalBest)) {
+		trace = other.trace;
+	}
+	return *this;
+}
+
+QStringList SolveStats::toText() const
+{
+	QStringList lines;
+	for (int i = 0; i < PhaseCount; ++i) {
+		if (calls[i]) {
+			lines << QString("%1: %2 ms in %3 calls").arg(phaseNames[i]).arg(nsecs[i] / 1e6, 0, 'f', 3).arg(calls[i]);
+		}
+	}
+	for (int i = 0; i < CounterCount; ++i) {
+		if (counters[i]) {
+			lines << QString("%1: %2").arg(counterNames[i]).arg(counters[i]);
+		}
+	}
+	return lines;
+}
+
+const char *SolveStats::phaseName(int phase)
+{
+	return phaseNames[phase];
+}
+
+const char *SolveStats::counterName(int counter)
+{
+	return counterNames[counter];
+}
+
+// QThreadStorage deletes what it holds, the stats are owned by the caller
+struct StatsSlot {
+	SolveStats *stats;
+};
+
+static QThreadStorage<StatsSlot *> &statsSlots()
+{
+	static QThreadStorage<StatsSlot *> storage;
+	return storage;
+}
+
+/*!
+\class StatsScope
+*/
+StatsScope::StatsScope(SolveStats *stats)
+{
+	StatsSlot *slot = statsSlots().localData();
+	if (!slot) {
+		slot = new StatsSlot;
+		slot->stats = 0;
+		statsSlots().setLocalData(slot);
+	}
+	m_previous = slot->stats;
+	slot->stats = stats;
+}
+
+StatsScope::~StatsScope()
+{
+	statsSlots().localData()->stats = m_previous;
+}
+
+SolveStats *StatsScope::current()
+{
+	StatsSlot *slot = statsSlots().localData();
+	return slot ? slot->stats : 0;
+}
+
+} // namespace GIS
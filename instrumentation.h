@@ -0,0 +1,130 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include "convergencetrace.h"
+
+namespace GIS {
+
+// Time spent in the phases of a solve and the work done in them. The thread
+// that solves collects them in the SolveStats of its StatsScope; objects
+// that may run on other threads, e.g. the colonies of a MultiColonyACS,
+// count into their own and add them up when they are done. An ACS run
+// also leaves its trace, if ACSParameters::traceCapacity() asks for one.
+struct SolveStats
+{
+	enum Phase {
+		ShortestPaths,
+		AcsStep,
+		AntStep,
+		LocalUpdate,
+		GlobalUpdate,
+		FullPath,
+		PhaseCount
+	};
+
+	enum Counter {
+		DesirabilityEvaluations,
+		PheromoneWrites,
+		Relaxations,
+		// objects created by the instrumented code: paths, edges and tour
+		// buffers
+		Allocations,
+		CounterCount
+	};
+
+	SolveStats() { clear(); }
+
+	void clear();
+	bool isEmpty() const;
+	// Adds the times and counters, keeps the trace that ends with the
+	// shorter tour
+	SolveStats &operator+=(const SolveStats &other);
+	// One line per phase and counter that was used
+	QStringList toText() const;
+
+	static const char *phaseName(int phase);
+	static const char *counterName(int counter);
+
+	qint64 nsecs[PhaseCount];
+	qint64 calls[PhaseCount];
+	qint64 counters[CounterCount];
+	ConvergenceTrace trace;
+};
+
+// Makes stats the collection point of the calling thread until destroyed,
+// then restores the previous one
+class StatsScope
+{
+public:
+	StatsScope(SolveStats *stats);
+	~StatsScope();
+
+	// Collection point of the calling thread, 0 if none
+	static SolveStats *current();
+
+private:
+	SolveStats *m_previous;
+};
+
+// Adds its lifetime and a number of calls to a phase; does nothing without
+// stats
+class ScopedTimer
+{
+public:
+	ScopedTimer(SolveStats *stats, SolveStats::Phase phase, int calls = 1)
+		: m_stats(stats), m_phase(phase), m_calls(calls)
+	{
+		if (m_stats) {
+			m_timer.start();
+		}
+	}
+
+	~ScopedTimer()
+	{
+		if (m_stats) {
+			m_stats->nsecs[m_phase] += m_timer.nsecsElapsed();
+			m_stats->calls[m_phase] += m_calls;
+		}
+	}
+
+private:
+	SolveStats *m_stats;
+	SolveStats::Phase m_phase;
+	int m_calls;
+	QElapsedTimer m_timer;
+};
+
+} // namespace GIS
+
+// The hooks of the hot paths. Building with GIS_NO_INSTRUMENTATION defined
+// removes them, their arguments are then not evaluated.
+#ifndef GIS_NO_INSTRUMENTATION
+
+#define GIS_CONCAT_(a, b) a##b
+#define GIS_CONCAT(a, b) GIS_CONCAT_(a, b)
+
+// Declares a SolveStats pointer to the calling thread's collection point
+#define GIS_CURRENT_STATS(name) GIS::SolveStats *name = GIS::StatsScope::current()
+// Times the rest of the enclosing block as a SolveStats::Phase
+#define GIS_TIME_PHASE(stats, phase) \
+	GIS::ScopedTimer GIS_CONCAT(gisTimer, __LINE__)(stats, GIS::SolveStats::phase)
+// The same for a block that does the work of several calls
+#define GIS_TIME_PHASE_N(stats, phase, calls) \
+	GIS::ScopedTimer GIS_CONCAT(gisTimer, __LINE__)(stats, GIS::SolveStats::phase, calls)
+// Adds n to a SolveStats::Counter; stats may be 0
+#define GIS_COUNT(stats, counter, n) \
+	do { if (GIS::SolveStats *gisStats = (stats)) gisStats->counters[GIS::SolveStats::counter] += (n); } while (0)
+
+#else
+
+#define GIS_CURRENT_STATS(name) do {} while (0)
+#define GIS_TIME_PHASE(stats, phase) do {} while (0)
+#define GIS_TIME_PHASE_N(stats, phase, calls) do {} while (0)
+#define GIS_COUNT(stats, counter, n) do {} while (0)
+
+#endif
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,152 @@
+#include "iteratedlocalsearch.h"
+#include "distancematrix.h"
+#include "canceltoken.h"
+
+#include <QElapsedTimer>
+
+namespace GIS {
+
+// Longest segment moved by a kick
+static const int KickSegmentLength = 50;
+
+/*!
+\class IteratedLocalSearch
+*/
+IteratedLocalSearch::IteratedLocalSearch(const DistanceMatrix *distances, int neighbours)
+	: TourNeighbourhood<IteratedLocalSearch>(distances, neighbours)
+	, m_cancel(0)
+	, m_timeLimit(0)
+	, m_length(0)
+	, m_initialLength(0)
+	, m_localOptimumLength(0)
+	, m_kicks(0)
+	, m_improvingKicks(0)
+{
+}
+
+void IteratedLocalSearch::setCancelToken(const CancelToken *cancel)
+{
+	m_cancel = cancel;
+}
+
+void IteratedLocalSearch::setTimeLimit(int msec)
+{
+	m_timeLimit = msec;
+}
+
+void IteratedLocalSearch::setSeed(quint64 seed)
+{
+	m_random.setSeed(seed);
+}
+
+bool IteratedLocalSearch::run(const QVector<int> &tour)
+{
+	Q_ASSERT(tour.size() == m_n);
+	m_bestTour = tour;
+	m_length = m_distances->tourLength(tour);
+	m_initialLength = m_length;
+	m_localOptimumLength = m_length;
+	m_kicks = 0;
+	m_improvingKicks = 0;
+	if (m_n < 4) {
+		return true;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	m_tour.setTour(tour);
+	queueAll(tour);
+	localSearch();
+	m_localOptimumLength = m_length;
+
+	bool canceled = false;
+	while (m_n >= 8 && timer.elapsed() < m_timeLimit) {
+		if (m_cancel && m_cancel->isCanceled()) {
+			canceled = true;
+			break;
+		}
+		int before = m_length;
+		m_moves.clear();
+		kick();
+		localSearch();
+		++m_kicks;
+		if (m_length < before) {
+			++m_improvingKicks;
+		} else if (m_length > before) {
+			undo();
+		}
+	}
+	m_moves.clear();
+
+	m_bestTour = m_tour.tour(tour.first());
+	return !canceled;
+}
+
+void IteratedLocalSearch::localSearch()
+{
+	for (int a = pop(); a >= 0; a = pop()) {
+		if (!improveTwoOpt(a)) {
+			improveOrOpt(a);
+		}
+	}
+}
+
+// Double bridge t1 | t2..t3 | t4..t5 | t6  =>  t1 | t4..t5 | t2..t3 | t6 as
+// three reversals
+void IteratedLocalSearch::kick()
+{
+	int maxLength = qMin(KickSegmentLength, (m_n - 2) / 2);
+	int t1 = m_random.nextInt(m_n);
+	int t2 = m_tour.next(t1);
+	int t3 = t2;
+	for (int i = m_random.nextInt(maxLength); i > 0; --i) {
+		t3 = m_tour.next(t3);
+	}
+	int t4 = m_tour.next(t3);
+	int t5 = t4;
+	for (int i = m_random.nextInt(maxLength); i > 0; --i) {
+		t5 = m_tour.next(t5);
+	}
+	int t6 = m_tour.next(t5);
+
+	make2OptMove(t1, t2, t5, t6);
+	make2OptMove(t1, t5, t4, t3);
+	make2OptMove(t5, t3, t2, t6);
+	push(t1);
+	push(t2);
+	push(t3);
+	push(t4);
+	push(t5);
+	push(t6);
+}
+
+// Replaces edges (a,b) and (c,e) with (a,c) and (b,e), where a->b->...->c->e
+// is the tour in one of its two directions, and records the move
+void IteratedLocalSearch::make2OptMove(int a, int b, int c, int e)
+{
+	Move move = { a, b, c, e };
+	m_moves.append(move);
+	flip(a, b, c, e);
+}
+
+void IteratedLocalSearch::flip(int a, int b, int c, int e)
+{
+	m_length += d(a, c) + d(b, e) - d(a, b) - d(c, e);
+	if (m_tour.next(a) == b) {
+		m_tour.reverse(b, c);
+	} else {
+		m_tour.reverse(c, b);
+	}
+}
+
+// a->c..b->e is the tour after a move, flipping it again restores the edges
+void IteratedLocalSearch::undo()
+{
+	for (int i = m_moves.size() - 1; i >= 0; --i) {
+		const Move &move = m_moves.at(i);
+		flip(move.a, move.c, move.b, move.e);
+	}
+	m_moves.clear();
+}
+
+} // namespace GIS
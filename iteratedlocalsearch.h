@@ -0,0 +1,76 @@
+#ifndef ITERATEDLOCALSEARCH_H
+#define ITERATEDLOCALSEARCH_H
+
+#include <QVector>
+
+#include "random.h"
+#include "twolevellist.h"
+#include "tourneighbourhood.h"
+
+namespace GIS {
+
+class CancelToken;
+
+// Improves a given tour until a time limit. The local search uses the moves
+// of LocalSearch (2-opt and Or-opt, i.e. the segment insertion part of
+// 3-opt, see TourNeighbourhood) on a TwoLevelList so that a move costs
+// O(sqrt n) on any instance size.
+// Once the tour is a local optimum it is kicked by a double bridge (two
+// short adjacent segments near a random vertex are swapped), only the
+// vertices around the kick are searched again, and the moves are undone if
+// the tour got longer.
+class IteratedLocalSearch : private TourNeighbourhood<IteratedLocalSearch>
+{
+public:
+	IteratedLocalSearch(const DistanceMatrix *distances, int neighbours = 10);
+
+	void setCancelToken(const CancelToken *cancel);
+	// Milliseconds spent kicking after the first local optimum, 0 stops there
+	void setTimeLimit(int msec);
+	void setSeed(quint64 seed);
+
+	// Improves the tour, a sequence of vertex indices. Returns false if
+	// canceled; the best tour is then the best one found so far.
+	bool run(const QVector<int> &tour);
+
+	// Starts with the same vertex as the given tour
+	const QVector<int> &bestTour() const { return m_bestTour; }
+	int bestLength() const { return m_length; }
+	int initialLength() const { return m_initialLength; }
+	// Length of the first local optimum, before any kick
+	int localOptimumLength() const { return m_localOptimumLength; }
+	int kicks() const { return m_kicks; }
+	int improvingKicks() const { return m_improvingKicks; }
+
+	friend class TourNeighbourhood<IteratedLocalSearch>;
+
+private:
+	struct Move {
+		int a, b, c, e;
+	};
+
+	int succ(int v, bool forward) const { return forward ? m_tour.next(v) : m_tour.prev(v); }
+
+	void localSearch();
+	void kick();
+	void make2OptMove(int a, int b, int c, int e);
+	void flip(int a, int b, int c, int e);
+	void undo();
+
+	const CancelToken *m_cancel;
+	int m_timeLimit;
+	Random m_random;
+	TwoLevelList m_tour;
+	int m_length;
+	// moves since the last accepted kick
+	QVector<Move> m_moves;
+	QVector<int> m_bestTour;
+	int m_initialLength;
+	int m_localOptimumLength;
+	int m_kicks;
+	int m_improvingKicks;
+};
+
+} // namespace GIS
+
+#endif // ITERATEDLOCALSEARCH_H
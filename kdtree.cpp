@@ -0,0 +1,178 @@
+#include "kdtree.h"
+
+#include <algorithm>
+
+namespace GIS {
+
+namespace {
+
+struct CoordinateLessThan {
+	CoordinateLessThan(const double *coordinates) : coordinates(coordinates) {}
+	bool operator()(int a, int b) const {
+		return coordinates[a] < coordinates[b];
+	}
+	const double *coordinates;
+};
+
+}
+
+// The k best points so far, sorted by distance and then index
+struct KdTree::Search {
+	bool accepts(double distance, int point) const {
+		if (points.size() < k) {
+			return true;
+		}
+		return distance < distances.last() || (distance == distances.last() && point < points.last());
+	}
+	void insert(double distance, int point) {
+		if (points.size() == k) {
+			points.remove(k - 1);
+			distances.remove(k - 1);
+		}
+		int i = points.size();
+		while (i > 0 && (distances.at(i - 1) > distance || (distances.at(i - 1) == distance && points.at(i - 1) > point))) {
+			--i;
+		}
+		points.insert(i, point);
+		distances.insert(i, distance);
+	}
+	double x;
+	double y;
+	int k;
+	int exclude;
+	QVector<int> points;
+	QVector<double> distances;
+};
+
+/*!
+\class KdTree
+*/
+const int KdTree::BucketSize;
+
+KdTree::KdTree(const QVector<double> &x, const QVector<double> &y)
+	: m_x(x)
+	, m_y(y)
+{
+	m_points.resize(m_x.size());
+	for (int i = 0; i < m_points.size(); ++i) {
+		m_points[i] = i;
+	}
+	if (!m_points.isEmpty()) {
+		m_nodes.reserve(2 * m_points.size() / BucketSize + 1);
+		build(0, m_points.size());
+	}
+}
+
+int KdTree::build(int first, int last)
+{
+	int index = m_nodes.size();
+	Node node = { first, last, -1, -1, 0, 0 };
+	m_nodes.append(node);
+	if (last - first <= BucketSize) {
+		return index;
+	}
+
+	double minX = m_x.at(m_points.at(first));
+	double maxX = minX;
+	double minY = m_y.at(m_points.at(first));
+	double maxY = minY;
+	for (int i = first + 1; i < last; ++i) {
+		int p = m_points.at(i);
+		minX = qMin(minX, m_x.at(p));
+		maxX = qMax(maxX, m_x.at(p));
+		minY = qMin(minY, m_y.at(p));
+		maxY = qMax(maxY, m_y.at(p));
+	}
+	int axis = maxY - minY > maxX - minX ? 1 : 0;
+	int middle = (first + last) / 2;
+	int *points = m_points.data();
+	std::nth_element(points + first, points + middle, points + last,
+					 CoordinateLessThan(axis == 0 ? m_x.constData() : m_y.constData()));
+
+	m_nodes[index].axis = axis;
+	m_nodes[index].split = coordinate(m_points.at(middle), axis);
+	// the children reorder their points and may move the node array
+	int left = build(first, middle);
+	int right = build(middle, last);
+	m_nodes[index].left = left;
+	m_nodes[index].right = right;
+	return index;
+}
+
+QVector<int> KdTree::nearest(double x, double y, int k, int exclude) const
+{
+	Search search;
+	search.x = x;
+	search.y = y;
+	search.k = k;
+	search.exclude = exclude;
+	if (k > 0 && !m_nodes.isEmpty()) {
+		search.points.reserve(k);
+		search.distances.reserve(k);
+		searchNearest(0, search);
+	}
+	return search.points;
+}
+
+// Squared distances throughout; the far side of a split is only visited if
+// it can still hold a point as near as the k-th one
+void KdTree::searchNearest(int index, Search &search) const
+{
+	const Node &node = m_nodes.at(index);
+	if (node.left < 0) {
+		for (int i = node.first; i < node.last; ++i) {
+			int p = m_points.at(i);
+			if (p == search.exclude) {
+				continue;
+			}
+			double dx = m_x.at(p) - search.x;
+			double dy = m_y.at(p) - search.y;
+			double distance = dx * dx + dy * dy;
+			if (search.accepts(distance, p)) {
+				search.insert(distance, p);
+			}
+		}
+		return;
+	}
+	double difference = (node.axis == 0 ? search.x : search.y) - node.split;
+	int nearSide = difference < 0 ? node.left : node.right;
+	int farSide = difference < 0 ? node.right : node.left;
+	searchNearest(nearSide, search);
+	if (search.points.size() < search.k || difference * difference <= search.distances.last()) {
+		searchNearest(farSide, search);
+	}
+}
+
+QVector<int> KdTree::withinRadius(double x, double y, double radius) const
+{
+	QVector<int> result;
+	if (!m_nodes.isEmpty() && radius >= 0) {
+		searchRadius(0, x, y, radius * radius, result);
+	}
+	return result;
+}
+
+void KdTree::searchRadius(int index, double x, double y, double squared, QVector<int> &result) const
+{
+	const Node &node = m_nodes.at(index);
+	if (node.left < 0) {
+		for (int i = node.first; i < node.last; ++i) {
+			int p = m_points.at(i);
+			double dx = m_x.at(p) - x;
+			double dy = m_y.at(p) - y;
+			if (dx * dx + dy * dy <= squared) {
+				result.append(p);
+			}
+		}
+		return;
+	}
+	double difference = (node.axis == 0 ? x : y) - node.split;
+	if (difference < 0 || difference * difference <= squared) {
+		searchRadius(node.left, x, y, squared, result);
+	}
+	if (difference >= 0 || difference * difference <= squared) {
+		searchRadius(node.right, x, y, squared, result);
+	}
+}
+
+} // namespace GIS
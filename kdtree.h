@@ -0,0 +1,57 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <QVector>
+
+namespace GIS {
+
+// 2-d tree over a set of points, built in O(n log n) by splitting every node
+// at the median of its wider side. Leaves hold up to BucketSize points, the
+// tree is stored as an array of nodes over a permutation of the point
+// indices. Queries use the real Euclidean distance; every rounding of
+// EuclideanDistance is monotone in it, so the nearest points come first for
+// the rounded distances too.
+class KdTree
+{
+public:
+	static const int BucketSize = 8;
+
+	KdTree(const QVector<double> &x, const QVector<double> &y);
+
+	int size() const { return m_x.size(); }
+
+	// Indices of the k points nearest to (x, y), nearest first, without the
+	// excluded one (e.g. the query point itself)
+	QVector<int> nearest(double x, double y, int k, int exclude = -1) const;
+	// Indices of the points within the radius of (x, y), in no given order
+	QVector<int> withinRadius(double x, double y, double radius) const;
+
+private:
+	struct Node {
+		// points m_points[first, last) below this node
+		int first;
+		int last;
+		// children, -1 for a leaf
+		int left;
+		int right;
+		// 0 splits on x, 1 on y
+		int axis;
+		double split;
+	};
+
+	struct Search;
+
+	int build(int first, int last);
+	void searchNearest(int node, Search &search) const;
+	void searchRadius(int node, double x, double y, double squared, QVector<int> &result) const;
+	double coordinate(int point, int axis) const { return axis == 0 ? m_x.at(point) : m_y.at(point); }
+
+	QVector<double> m_x;
+	QVector<double> m_y;
+	QVector<int> m_points;
+	QVector<Node> m_nodes;
+};
+
+} // namespace GIS
+
+#endif // KDTREE_H
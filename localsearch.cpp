@@ -0,0 +1,91 @@
+#include "localsearch.h"
+#include "distancematrix.h"
+
+namespace GIS {
+
+/*!
+\class LocalSearch
+*/
+LocalSearch::LocalSearch(const DistanceMatrix *distances, int neighbours)
+	: TourNeighbourhood<LocalSearch>(distances, neighbours)
+{
+	m_tour.resize(m_n);
+	m_pos.resize(m_n);
+}
+
+int LocalSearch::improve(QVector<int> &tour, Type type)
+{
+	Q_ASSERT(tour.size() == m_n);
+	if (type == None || m_n < 4) {
+		return m_distances->tourLength(tour);
+	}
+
+	for (int i = 0; i < m_n; ++i) {
+		m_tour[i] = tour.at(i);
+		m_pos[m_tour.at(i)] = i;
+	}
+
+	queueAll(m_tour);
+	for (int a = pop(); a >= 0; a = pop()) {
+		bool improved = false;
+		if (type == TwoOpt || type == TwoOptOrOpt) {
+			improved = improveTwoOpt(a);
+		}
+		if (!improved && (type == OrOpt || type == TwoOptOrOpt)) {
+			improved = improveOrOpt(a);
+		}
+	}
+
+	// rotate back so that the first vertex stays first
+	int v = tour.first();
+	for (int i = 0; i < m_n; ++i) {
+		tour[i] = v;
+		v = next(v);
+	}
+	return m_distances->tourLength(tour);
+}
+
+void LocalSearch::make2OptMove(int a, int b, int c, int e)
+{
+	Q_UNUSED(e);
+	if (next(a) == b) {
+		reversePath(b, c);
+	} else {
+		reversePath(c, b);
+	}
+}
+
+// Reverses the path from..to (following next()), or the complementary path
+// if that one is shorter - both give the same cyclic tour
+void LocalSearch::reversePath(int from, int to)
+{
+	int i = m_pos.at(from);
+	int j = m_pos.at(to);
+	int len = j - i;
+	if (len < 0) {
+		len += m_n;
+	}
+	++len;
+	if (2 * len > m_n) {
+		int ni = j + 1 == m_n ? 0 : j + 1;
+		j = i == 0 ? m_n - 1 : i - 1;
+		i = ni;
+		len = m_n - len;
+	}
+	for (int s = 0; s < len / 2; ++s) {
+		int vi = m_tour.at(i);
+		int vj = m_tour.at(j);
+		m_tour[i] = vj;
+		m_pos[vj] = i;
+		m_tour[j] = vi;
+		m_pos[vi] = j;
+		if (++i == m_n) {
+			i = 0;
+		}
+		if (--j < 0) {
+			j = m_n - 1;
+		}
+	}
+}
+
+} // namespace GIS
@@ -0,0 +1,46 @@
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+#include <QVector>
+
+#include "tourneighbourhood.h"
+
+namespace GIS {
+
+// 2-opt / Or-opt tour improvement (see TourNeighbourhood).
+// The tour is kept as an array with a position index per vertex; every move
+// is done by reversing the shorter side of the affected segment.
+class LocalSearch : private TourNeighbourhood<LocalSearch>
+{
+public:
+	enum Type {
+		None,
+		TwoOpt,
+		OrOpt,
+		TwoOptOrOpt
+	};
+
+	LocalSearch(const DistanceMatrix *distances, int neighbours = 10);
+
+	// Improves a closed tour given as a sequence of vertex indices (the
+	// start vertex is not repeated at the end). The first vertex stays first.
+	// Returns the length of the improved tour.
+	int improve(QVector<int> &tour, Type type);
+
+	friend class TourNeighbourhood<LocalSearch>;
+
+private:
+	int next(int v) const { return m_tour.at(m_pos.at(v) + 1 == m_n ? 0 : m_pos.at(v) + 1); }
+	int prev(int v) const { return m_tour.at(m_pos.at(v) == 0 ? m_n - 1 : m_pos.at(v) - 1); }
+	int succ(int v, bool forward) const { return forward ? next(v) : prev(v); }
+
+	void make2OptMove(int a, int b, int c, int e);
+	void reversePath(int from, int to);
+
+	QVector<int> m_tour;
+	QVector<int> m_pos;
+};
+
+} // namespace GIS
+
+#endif // LOCALSEARCH_H
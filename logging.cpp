@@ -0,0 +1,302 @@
+#include "logging.h"
+
+#include <QMetaObject>
+#include <QThread>
+#include <QWaitCondition>
+#include <cstdio>
+
+namespace GIS {
+
+// Bounded multi-producer queue (Vyukov): a writer claims a position with
+// one compare-and-swap and publishes the cell through its sequence number,
+// so writers never wait for each other or for the reader. There is a
+// single reader at a time, the holder of Log::m_drainMutex.
+class LogQueue
+{
+public:
+	// capacity must be a power of 2
+	LogQueue(int capacity) : m_cells(new Cell[capacity]), m_mask(capacity - 1), m_tail(0), m_head(0)
+	{
+		for (int i = 0; i < capacity; ++i) {
+			m_cells[i].sequence = i;
+		}
+	}
+
+	~LogQueue()
+	{
+		delete [] m_cells;
+	}
+
+	// False if the queue is full
+	bool push(const LogRecord &record)
+	{
+		int position = m_tail;
+		Cell *cell;
+		for (;;) {
+			cell = &m_cells[position & m_mask];
+			int difference = int(unsigned(cell->sequence.fetchAndAddAcquire(0)) - unsigned(position));
+			if (difference == 0) {
+				if (m_tail.testAndSetRelaxed(position, next(position))) {
+					break;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = m_tail;
+			}
+		}
+		cell->record = record;
+		cell->sequence.fetchAndStoreRelease(next(position));
+		return true;
+	}
+
+	bool pop(LogRecord *record)
+	{
+		Cell *cell = &m_cells[m_head & m_mask];
+		if (cell->sequence.fetchAndAddAcquire(0) != next(m_head)) {
+			return false;
+		}
+		*record = cell->record;
+		// release the text now rather than when the cell is reused
+		cell->record = LogRecord();
+		cell->sequence.fetchAndStoreRelease(int(unsigned(m_head) + m_mask + 1));
+		m_head = next(m_head);
+		return true;
+	}
+
+private:
+	struct Cell {
+		QAtomicInt sequence;
+		LogRecord record;
+	};
+
+	static int next(int position) { return int(unsigned(position) + 1); }
+
+	Cell *m_cells;
+	int m_mask;
+	QAtomicInt m_tail;
+	int m_head;
+};
+
+// Drains the queue every DrainInterval milliseconds until stopped
+class LogThread : public QThread
+{
+public:
+	static const int DrainInterval = 20;
+
+	LogThread(Log *log) : m_log(log), m_stopping(false) {}
+
+	void stop()
+	{
+		QMutexLocker locker(&m_mutex);
+		m_stopping = true;
+		m_wake.wakeAll();
+	}
+
+protected:
+	void run()
+	{
+		QMutexLocker locker(&m_mutex);
+		while (!m_stopping) {
+			locker.unlock();
+			m_log->drain();
+			locker.relock();
+			if (!m_stopping) {
+				m_wake.wait(&m_mutex, DrainInterval);
+			}
+		}
+	}
+
+private:
+	Log *m_log;
+	QMutex m_mutex;
+	QWaitCondition m_wake;
+	bool m_stopping;
+};
+
+static const int QueueCapacity = 8192;
+
+static const char *const levelNames[] = { "debug", "info", "warning", "error", "off" };
+
+/*!
+\class Log
+*/
+Log::Log()
+	: m_queue(new LogQueue(QueueCapacity))
+	, m_thread(0)
+	, m_threshold(Off)
+	, m_dropped(0)
+	, m_reportedDropped(0)
+	, m_level(Info)
+{
+	m_clock.start();
+}
+
+Log::~Log()
+{
+	if (m_thread) {
+		m_thread->stop();
+		m_thread->wait();
+		delete m_thread;
+	}
+	drain();
+	qDeleteAll(m_sinks);
+	delete m_queue;
+}
+
+Log &Log::instance()
+{
+	static Log log;
+	return log;
+}
+
+void Log::setLevel(Level level)
+{
+	QMutexLocker locker(&m_drainMutex);
+	m_level = level;
+	updateThreshold();
+}
+
+Log::Level Log::level() const
+{
+	return m_level;
+}
+
+void Log::write(Level level, Channel channel, const QString &text)
+{
+	LogRecord record;
+	record.level = level;
+	record.channel = channel;
+	record.msec = m_clock.elapsed();
+	record.text = text;
+	if (!m_queue->push(record)) {
+		m_dropped.fetchAndAddRelaxed(1);
+	}
+}
+
+void Log::addSink(LogSink *sink)
+{
+	QMutexLocker locker(&m_drainMutex);
+	m_sinks.append(sink);
+	updateThreshold();
+	if (!m_thread) {
+		m_thread = new LogThread(this);
+		m_thread->start();
+	}
+}
+
+void Log::removeSink(LogSink *sink)
+{
+	QMutexLocker locker(&m_drainMutex);
+	m_sinks.removeAll(sink);
+	delete sink;
+	updateThreshold();
+}
+
+void Log::flush()
+{
+	drain();
+}
+
+int Log::dropped() const
+{
+	return m_dropped;
+}
+
+const char *Log::levelName(int level)
+{
+	return levelNames[qBound(int(Debug), level, int(Off))];
+}
+
+void Log::drain()
+{
+	QMutexLocker locker(&m_drainMutex);
+	LogRecord record;
+	bool written = false;
+	while (m_queue->pop(&record)) {
+		foreach (LogSink *sink, m_sinks) {
+			if (sink->accepts(record.channel)) {
+				sink->write(record);
+			}
+		}
+		written = true;
+	}
+	int dropped = m_dropped;
+	if (dropped != m_reportedDropped) {
+		record.level = Warning;
+		record.channel = AllChannels;
+		record.msec = m_clock.elapsed();
+		record.text = QString("%1 log records dropped").arg(dropped - m_reportedDropped);
+		m_reportedDropped = dropped;
+		foreach (LogSink *sink, m_sinks) {
+			sink->write(record);
+		}
+		written = true;
+	}
+	if (written) {
+		foreach (LogSink *sink, m_sinks) {
+			sink->flush();
+		}
+	}
+}
+
+// Called with m_drainMutex held
+void Log::updateThreshold()
+{
+	m_threshold = m_sinks.isEmpty() ? int(Off) : int(m_level);
+}
+
+/*!
+\class ReceiverSink
+*/
+void ReceiverSink::write(const LogRecord &record)
+{
+	m_lines.append(record.text);
+}
+
+void ReceiverSink::flush()
+{
+	if (!m_lines.isEmpty()) {
+		QMetaObject::invokeMethod(m_receiver, "appendPlainText", Qt::QueuedConnection, Q_ARG(QString, m_lines.join("\n")));
+		m_lines.clear();
+	}
+}
+
+/*!
+\class FileSink
+*/
+FileSink::FileSink(const QString &fileName, int channels)
+	: LogSink(channels)
+	, m_file(fileName)
+{
+	m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
+
+bool FileSink::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+void FileSink::write(const LogRecord &record)
+{
+	if (!m_file.isOpen()) {
+		return;
+	}
+	QString line = QString("%1 %2: %3\n").arg(record.msec / 1000.0, 0, 'f', 3).arg(Log::levelName(record.level)).arg(record.text);
+	m_file.write(line.toUtf8());
+}
+
+void FileSink::flush()
+{
+	m_file.flush();
+}
+
+/*!
+\class StderrSink
+*/
+void StderrSink::write(const LogRecord &record)
+{
+	std::fprintf(stderr, "%s: %s\n", Log::levelName(record.level), record.text.toLocal8Bit().constData());
+}
+
+} // namespace GIS
@@ -0,0 +1,170 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class QObject;
+
+namespace GIS {
+
+class LogQueue;
+class LogThread;
+class LogSink;
+
+struct LogRecord
+{
+	LogRecord() : level(0), channel(0), msec(0) {}
+
+	int level;
+	int channel;
+	// since the log was created
+	qint64 msec;
+	QString text;
+};
+
+// Log of the solvers. write() only puts the record in a fixed-size
+// lock-free queue, a background thread hands the records to the sinks;
+// when the queue is full records are dropped and counted rather than
+// blocking the writer. Nothing passes the level while there is no sink, so
+// disabled logging costs a comparison; use GIS_LOG(), which also skips the
+// formatting of the text.
+class Log
+{
+public:
+	enum Level {
+		Debug,
+		Info,
+		Warning,
+		Error,
+		Off
+	};
+
+	// The console panes of the GUI take one channel each
+	enum Channel {
+		General = 1,
+		BruteForce = 2,
+		AntColony = 4,
+		AllChannels = General | BruteForce | AntColony
+	};
+
+	static Log &instance();
+
+	// Lowest level written, Info by default
+	void setLevel(Level level);
+	Level level() const;
+	static bool isEnabled(Level level) { return level >= int(instance().m_threshold); }
+
+	void write(Level level, Channel channel, const QString &text);
+	// Takes ownership
+	void addSink(LogSink *sink);
+	// Deletes the sink; no record reaches it after the call
+	void removeSink(LogSink *sink);
+	// Hands the queued records to the sinks before returning
+	void flush();
+	// Records lost to a full queue
+	int dropped() const;
+
+	static const char *levelName(int level);
+
+	friend class LogThread;
+
+private:
+	Log();
+	Log(const Log &other);
+	~Log();
+
+	void drain();
+	void updateThreshold();
+
+	LogQueue *m_queue;
+	LogThread *m_thread;
+	// lowest level that passes, Off without sinks
+	QAtomicInt m_threshold;
+	QAtomicInt m_dropped;
+	// part of m_dropped already reported to the sinks
+	int m_reportedDropped;
+	Level m_level;
+	QElapsedTimer m_clock;
+	// held while the sinks are written, guards them
+	QMutex m_drainMutex;
+	QList<LogSink *> m_sinks;
+};
+
+// Receives the records of some channels on the log's thread
+class LogSink
+{
+public:
+	LogSink(int channels = Log::AllChannels) : m_channels(channels) {}
+	virtual ~LogSink() {}
+
+	bool accepts(int channel) const { return (m_channels & channel) != 0; }
+	virtual void write(const LogRecord &record) = 0;
+	// After every batch of records
+	virtual void flush() {}
+
+private:
+	int m_channels;
+};
+
+// Appends the text of the records to an object with an
+// appendPlainText(QString) slot, e.g. a QPlainTextEdit, in the object's
+// thread; one call per batch
+class ReceiverSink : public LogSink
+{
+public:
+	ReceiverSink(QObject *receiver, int channels = Log::AllChannels)
+		: LogSink(channels), m_receiver(receiver) {}
+
+	void write(const LogRecord &record);
+	void flush();
+
+private:
+	QObject *m_receiver;
+	QStringList m_lines;
+};
+
+// Appends the records to a file with their time and level
+class FileSink : public LogSink
+{
+public:
+	FileSink(const QString &fileName, int channels = Log::AllChannels);
+
+	bool isOpen() const;
+	void write(const LogRecord &record);
+	void flush();
+
+private:
+	QFile m_file;
+};
+
+class StderrSink : public LogSink
+{
+public:
+	StderrSink(int channels = Log::AllChannels) : LogSink(channels) {}
+
+	void write(const LogRecord &record);
+};
+
+} // namespace GIS
+
+// Records below GIS_LOG_LEVEL (a GIS::Log::Level, Debug by default) are
+// removed at compile time
+#ifndef GIS_LOG_LEVEL
+#define GIS_LOG_LEVEL 0
+#endif
+
+#define GIS_LOG_ENABLED(level) \
+	(GIS::Log::level >= GIS_LOG_LEVEL && GIS::Log::isEnabled(GIS::Log::level))
+// The text is only evaluated if the record is written
+#define GIS_LOG(level, channel, text) \
+	do { if (GIS_LOG_ENABLED(level)) GIS::Log::instance().write(GIS::Log::level, GIS::Log::channel, (text)); } while (0)
+#define GIS_DEBUG(text) GIS_LOG(Debug, General, text)
+#define GIS_WARNING(text) GIS_LOG(Warning, General, text)
+
+#endif // LOGGING_H
@@ -0,0 +1,182 @@
+#include "lowerbound.h"
+#include "distancematrix.h"
+#include "construction.h"
+#include "localsearch.h"
+#include "canceltoken.h"
+
+namespace GIS {
+
+// Tolerance of the real valued bounds, relative to the tour length
+static const double BoundEpsilon = 1e-9;
+// Ascent iterations at most, besides 100 per vertex
+static const int MaxIterations = 5000;
+
+/*!
+\class LowerBound
+*/
+LowerBound::LowerBound(const DistanceMatrix *distances)
+	: m_distances(distances)
+	, m_cancel(0)
+	, m_n(distances->size())
+	, m_upperBound(-1)
+	, m_bound(0)
+	, m_iterations(0)
+{
+}
+
+void LowerBound::setCancelToken(const CancelToken *cancel)
+{
+	m_cancel = cancel;
+}
+
+void LowerBound::setUpperBound(int length)
+{
+	m_upperBound = length;
+}
+
+double LowerBound::gap(int length, double bound)
+{
+	if (bound <= 0) {
+		return 0;
+	}
+	return 100.0 * (length - bound) / bound;
+}
+
+// Keeps the best penalties; the step is lambda (U - bound) / |deg - 2|^2 and
+// lambda halves after a period without improvement
+bool LowerBound::run()
+{
+	m_penalties.fill(0, m_n);
+	m_bound = 0;
+	m_iterations = 0;
+	if (m_n < 3) {
+		m_bound = m_n == 2 ? 2 * m_distances->distance(0, 1) : 0;
+		return true;
+	}
+	if (m_upperBound < 0) {
+		QVector<int> tour = Construction::nearestNeighbour(m_distances);
+		LocalSearch localSearch(m_distances);
+		m_upperBound = localSearch.improve(tour, LocalSearch::TwoOptOrOpt);
+	}
+
+	QVector<double> pi(m_n, 0);
+	QVector<int> degrees(m_n);
+	m_key.resize(m_n);
+	m_parent.resize(m_n);
+	m_inTree.resize(m_n);
+	double best = -1;
+	double lambda = 2;
+	int sinceImprovement = 0;
+	// longer periods hardly help on large instances
+	int period = qBound(10, m_n / 2, 20);
+	int maxIterations = qMin(100 * m_n, MaxIterations);
+
+	bool canceled = false;
+	for (; m_iterations < maxIterations && lambda > 1e-6; ++m_iterations) {
+		if (m_cancel && m_cancel->isCanceled()) {
+			canceled = true;
+			break;
+		}
+		double sum = 0;
+		for (int i = 0; i < m_n; ++i) {
+			sum += pi.at(i);
+		}
+		double bound = oneTree(pi, degrees) - 2 * sum;
+		if (bound > best) {
+			best = bound;
+			m_penalties = pi;
+			sinceImprovement = 0;
+		} else if (++sinceImprovement >= period) {
+			lambda /= 2;
+			sinceImprovement = 0;
+		}
+
+		int norm = 0;
+		for (int i = 0; i < m_n; ++i) {
+			norm += (degrees.at(i) - 2) * (degrees.at(i) - 2);
+		}
+		// the 1-tree is a tour
+		if (norm == 0 || !canImprove(bound)) {
+			break;
+		}
+		double step = lambda * (m_upperBound - bound) / norm;
+		for (int i = 0; i < m_n; ++i) {
+			pi[i] += step * (degrees.at(i) - 2);
+		}
+	}
+	m_bound = qMax(best, 0.0);
+	return !canceled;
+}
+
+// Minimum spanning tree of vertices 1..n-1 (Prim) plus the two cheapest
+// edges of vertex 0, under the penalised costs. The keys are updated and the
+// next vertex found in the same pass.
+double LowerBound::oneTree(const QVector<double> &penalties, QVector<int> &degrees)
+{
+	const double *pi = penalties.constData();
+	double *key = m_key.data();
+	int *parent = m_parent.data();
+	bool *inTree = m_inTree.data();
+	degrees.fill(0);
+	double total = 0;
+
+	int u = 1;
+	for (int v = 2; v < m_n; ++v) {
+		key[v] = DistanceMatrix::Infinity * 4.0;
+		inTree[v] = false;
+	}
+	for (int added = 1; added < m_n - 1; ++added) {
+		inTree[u] = true;
+		const int *row = m_distances->row(u);
+		double piU = pi[u];
+		int next = -1;
+		for (int v = 2; v < m_n; ++v) {
+			if (inTree[v]) {
+				continue;
+			}
+			double c = row[v] + piU + pi[v];
+			if (c < key[v]) {
+				key[v] = c;
+				parent[v] = u;
+			}
+			if (next < 0 || key[v] < key[next]) {
+				next = v;
+			}
+		}
+		u = next;
+		total += key[u];
+		++degrees[u];
+		++degrees[parent[u]];
+	}
+
+	const int *row = m_distances->row(0);
+	int first = -1;
+	int second = -1;
+	double firstCost = 0;
+	double secondCost = 0;
+	for (int v = 1; v < m_n; ++v) {
+		double c = row[v] + pi[0] + pi[v];
+		if (first < 0 || c < firstCost) {
+			second = first;
+			secondCost = firstCost;
+			first = v;
+			firstCost = c;
+		} else if (second < 0 || c < secondCost) {
+			second = v;
+			secondCost = c;
+		}
+	}
+	total += firstCost + secondCost;
+	degrees[0] = 2;
+	++degrees[first];
+	++degrees[second];
+	return total;
+}
+
+// A tour shorter than the upper bound may still exist
+bool LowerBound::canImprove(double bound) const
+{
+	return bound < m_upperBound - 1 + BoundEpsilon * m_upperBound + BoundEpsilon;
+}
+
+} // namespace GIS
@@ -0,0 +1,58 @@
+#ifndef LOWERBOUND_H
+#define LOWERBOUND_H
+
+#include <QVector>
+
+namespace GIS {
+
+class DistanceMatrix;
+class CancelToken;
+
+// Held-Karp lower bound on the length of every tour. Under the penalties pi
+// the edge (i, j) costs d(i, j) + pi(i) + pi(j), which makes every tour
+// longer by exactly 2 sum(pi), so a minimum 1-tree (spanning tree of the
+// vertices other than 0 plus the two cheapest edges of 0) minus 2 sum(pi) is
+// a bound. Subgradient ascent moves pi(i) with deg(i) - 2 until the step is
+// negligible. The 1-trees are built by Prim on the dense matrix in O(n^2).
+class LowerBound
+{
+public:
+	LowerBound(const DistanceMatrix *distances);
+
+	void setCancelToken(const CancelToken *cancel);
+	// Length of a known tour: it scales the steps and the ascent stops once
+	// the bound proves the tour optimal. Without one a nearest neighbour
+	// tour improved by 2-opt/Or-opt is used.
+	void setUpperBound(int length);
+
+	// Returns false if canceled; the bound is then the best one so far
+	bool run();
+
+	double bound() const { return m_bound; }
+	// The penalties giving bound()
+	const QVector<double> &penalties() const { return m_penalties; }
+	int iterations() const { return m_iterations; }
+
+	// Percent by which a tour of the given length exceeds the bound
+	static double gap(int length, double bound);
+
+private:
+	double oneTree(const QVector<double> &penalties, QVector<int> &degrees);
+	bool canImprove(double bound) const;
+
+	const DistanceMatrix *m_distances;
+	const CancelToken *m_cancel;
+	int m_n;
+	int m_upperBound;
+	double m_bound;
+	QVector<double> m_penalties;
+	int m_iterations;
+	// scratch space of Prim
+	QVector<double> m_key;
+	QVector<int> m_parent;
+	QVector<bool> m_inTree;
+};
+
+} // namespace GIS
+
+#endif // LOWERBOUND_H
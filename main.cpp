@@ -3,10 +3,13 @@
 #include "graph.h"
 #include "graphmodel.h"
 #include "mainwindow.h"
+#include "logging.h"
 
 int main(int argc, char *argv[])
 {
 	QApplication app(argc, argv);
+	// the BF and ACS channels go to the console panes
+	GIS::Log::instance().addSink(new GIS::StderrSink(GIS::Log::General));
 	MainWindow w;
 
 	QString filename;
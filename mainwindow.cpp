@@ -2,11 +2,12 @@
 #include "ui_mainwindow.h"
 #include "singletons.h"
 #include "graphgeneratorwidget.h"
+#include "solverthread.h"
+#include "lowerbound.h"
 
 #include <QFileDialog>
 #include <QDialog>
 #include <QMessageBox>
-#include <QTime>
 #include <QStandardItemModel>
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -23,21 +24,55 @@ MainWindow::MainWindow(QWidget *parent) :
 	m_model = new GIS::GraphModel(this);
 	ui->graphView->setModel(m_model);
 
+	m_acsSolver = new SolverThread(this);
+	m_bfSolver = new SolverThread(this);
+	connect(m_acsSolver, SIGNAL(finished()), SLOT(acsFinished()));
+	connect(m_acsSolver, SIGNAL(bestTourChanged(QStringList,int,int)), SLOT(showAcsBestTour(QStringList,int,int)));
+	connect(m_acsSolver, SIGNAL(progress(int,int,int)), SLOT(showAcsProgress(int,int,int)));
+	connect(m_bfSolver, SIGNAL(finished()), SLOT(bruteForceFinished()));
+
 	connect(ui->toCompleteButton, SIGNAL(clicked()), SLOT(turnTuComplete()));
 	connect(ui->actionOpen_file, SIGNAL(triggered()), SLOT(open()));
 	connect(ui->acsRunButton, SIGNAL(clicked()), SLOT(runAcs()));
 	connect(ui->bfRunButton, SIGNAL(clicked()), SLOT(runBruteForce()));
 	connect(ui->actionGenerate_graph, SIGNAL(triggered()), SLOT(generateGraph()));
+	connect(ui->betaSpin, SIGNAL(valueChanged(double)), SLOT(setBeta(double)));
+	connect(ui->phiSpin, SIGNAL(valueChanged(double)), SLOT(setPhi(double)));
+	connect(ui->pheromoneSpin, SIGNAL(valueChanged(int)), SLOT(setPheromone(int)));
+	connect(ui->seedSpin, SIGNAL(valueChanged(int)), SLOT(setSeed(int)));
+	connect(ui->localSearchCombo, SIGNAL(currentIndexChanged(int)), SLOT(setLocalSearch(int)));
+	connect(ui->localSearchAllCheck, SIGNAL(toggled(bool)), SLOT(setLocalSearchAllAnts(bool)));
+	connect(ui->coloniesSpin, SIGNAL(valueChanged(int)), SLOT(setColonies(int)));
+	connect(ui->migrationSpin, SIGNAL(valueChanged(int)), SLOT(setMigrationInterval(int)));
+	connect(ui->topologyCombo, SIGNAL(currentIndexChanged(int)), SLOT(setMigrationTopology(int)));
+	connect(ui->iterationsSpin, SIGNAL(valueChanged(int)), SLOT(setIterations(int)));
+	connect(ui->antsSpin, SIGNAL(valueChanged(int)), SLOT(setAnts(int)));
+	connect(ui->timeBudgetSpin, SIGNAL(valueChanged(int)), SLOT(setTimeBudget(int)));
+	connect(ui->stagnationSpin, SIGNAL(valueChanged(int)), SLOT(setStagnationLimit(int)));
+	connect(ui->q0Spin, SIGNAL(valueChanged(double)), SLOT(setQ0(double)));
+	connect(ui->variantCombo, SIGNAL(currentIndexChanged(int)), SLOT(setVariant(int)));
+	connect(ui->alphaSpin, SIGNAL(valueChanged(double)), SLOT(setAlpha(double)));
+	connect(ui->memoryBudgetSpin, SIGNAL(valueChanged(int)), SLOT(setMemoryBudget(int)));
+	connect(ui->targetGapSpin, SIGNAL(valueChanged(double)), SLOT(setTargetGap(double)));
+	connect(ui->improvementTimeSpin, SIGNAL(valueChanged(int)), SLOT(setImprovementTimeLimit(int)));
+	connect(ui->autoPheromoneCheck, SIGNAL(toggled(bool)), SLOT(setAutoPheromone(bool)));
+	connect(ui->traceCheck, SIGNAL(toggled(bool)), SLOT(setTrace(bool)));
+	connect(ui->exportTraceButton, SIGNAL(clicked()), SLOT(exportTrace()));
 
 	ui->bfConsole->setStyleSheet("font-family : \"Consolas\", \"monospace\", \"Courier New\"");
 	ui->acsConsole->setStyleSheet("font-family : \"Consolas\", \"monospace\", \"Courier New\"");
 
-	BFLogger::instance().setPlainTextEdit(ui->bfConsole);
-	ACSLogger::instance().setPlainTextEdit(ui->acsConsole);
+	BFLogger::instance().setReceiver(ui->bfConsole);
+	ACSLogger::instance().setReceiver(ui->acsConsole);
 }
 
 MainWindow::~MainWindow()
 {
+	// cancel and wait for running solves before the widgets go away
+	delete m_acsSolver;
+	delete m_bfSolver;
+	BFLogger::instance().setReceiver(0);
+	ACSLogger::instance().setReceiver(0);
     delete ui;
 }
 
@@ -46,7 +81,7 @@ void MainWindow::open()
 	QString filename = QFileDialog::getOpenFileName(this,
 													tr("Open file..."),
 													QApplication::applicationDirPath(),
-													"*.xml");
+													tr("Graphs (*.xml *.tsp)"));
 	if (filename.isEmpty())
 		return;
 	open(filename);
@@ -60,7 +95,7 @@ void MainWindow::open(const QString &filename)
 		m_graph = 0;
 	}
 	m_graph = new GIS::Graph;
-	if (!m_graph->readFromFile(filename)) {
+	if (!m_graph->load(filename)) {
 		QMessageBox::critical(this, tr("Error"),
 							  tr("Cannot open file: %1").arg(filename));
 		return;
@@ -83,66 +118,184 @@ void MainWindow::turnTuComplete()
 	m_model->setGraph(m_graph);
 }
 
-void MainWindow::runAcs()
+bool MainWindow::canSolve()
 {
 	if (!m_graph) {
 		QMessageBox::warning(this, tr("Error"), tr("Load a graph first!"));
-		return;
+		return false;
 	}
 	if (!m_graph->isConnected()) {
 		QMessageBox::critical(this, tr("Error"), tr("Graph is not connected!"));
-		return;
+		return false;
 	}
-	QTime time;
-	time.start();
-	GIS::Path *shortestPath = m_graph->tspPath(GIS::Graph::ACS);
-	int msec = time.elapsed();
-	ACSLogger::instance().log(tr("Time elapsed: ") + QString::number((double)msec/1000.0, 'f', 3) + "s");
-	ACSLogger::instance().log("-------------------------------");
+	return true;
+}
+
+// The graph must stay untouched while a solver works on it
+void MainWindow::updateSolvingState()
+{
+	bool acsRunning = m_acsSolver->isRunning();
+	bool bfRunning = m_bfSolver->isRunning();
+	ui->acsRunButton->setText(acsRunning ? tr("Cancel") : tr("Run"));
+	ui->bfRunButton->setText(bfRunning ? tr("Cancel") : tr("Run"));
+	ui->solverCombo->setEnabled(!bfRunning);
+	ui->actionOpen_file->setEnabled(!acsRunning && !bfRunning);
+	ui->toCompleteButton->setEnabled(!acsRunning && !bfRunning);
+}
+
+// Gap of a tour to the Held-Karp bound, "-" if the bound is unknown
+QString MainWindow::gapText(int length, double bound)
+{
+	if (bound <= 0) {
+		return "-";
+	}
+	return QString::number(GIS::LowerBound::gap(length, bound), 'f', 2) + "%";
+}
+
+void MainWindow::showTour(QAbstractItemView *view, const QStringList &labels)
+{
 	QStandardItemModel *model = 0;
-	if (ui->acsResultView->model()) {
-		model = static_cast<QStandardItemModel *>(ui->acsResultView->model());
+	if (view->model()) {
+		model = static_cast<QStandardItemModel *>(view->model());
 		model->clear();
 	} else {
-		model = new QStandardItemModel(ui->acsResultView);
-		ui->acsResultView->setModel(model);
+		model = new QStandardItemModel(view);
+		view->setModel(model);
 	}
-	foreach (GIS::Vertex *v, shortestPath->vertices()) {
-		model->appendRow(new QStandardItem(v->label()));
+	foreach (const QString &label, labels) {
+		model->appendRow(new QStandardItem(label));
+	}
+}
+
+// Also cancels a running ACS
+void MainWindow::runAcs()
+{
+	if (m_acsSolver->isRunning()) {
+		m_acsSolver->cancel();
+		return;
+	}
+	if (!canSolve()) {
+		return;
+	}
+	m_graph->setAcsWarmStart(ui->warmStartCheck->isChecked() ? m_acsSnapshot : GIS::ACSSnapshot());
+	ui->acsGapLabel->setText("-");
+	m_acsSolver->setLowerBound(ui->acsBoundCheck->isChecked());
+	m_acsSolver->solve(m_graph, GIS::Graph::ACS);
+	updateSolvingState();
+}
+
+void MainWindow::acsFinished()
+{
+	updateSolvingState();
+	GIS::Path *shortestPath = m_acsSolver->takeResult();
+	int msec = m_acsSolver->elapsed();
+	double bound = m_acsSolver->lowerBound();
+	if (shortestPath && bound > 0) {
+		ACSLogger::instance().log(tr("Lower bound: %1, gap: %2").arg(bound, 0, 'f', 1).arg(gapText(shortestPath->totalCost(), bound)));
+	}
+	m_acsSnapshot = m_graph->acsSnapshot();
+	if (!m_acsSnapshot.bestTour.isEmpty()) {
+		m_lastTour = m_acsSnapshot.bestTour;
+	}
+	ACSLogger::instance().log(tr("Time elapsed: ") + QString::number((double)msec/1000.0, 'f', 3) + "s");
+	if (ui->acsStatsCheck->isChecked()) {
+		foreach (const QString &line, m_acsSolver->stats().toText()) {
+			ACSLogger::instance().log(line);
+		}
 	}
+	m_trace = m_acsSolver->stats().trace;
+	ui->exportTraceButton->setEnabled(!m_trace.isEmpty());
+	ACSLogger::instance().log("-------------------------------");
 	ui->acsTimeLabel->setText(QString::number((double)msec/1000.0, 'f', 3) + "s");
+	if (!shortestPath) {
+		ACSLogger::instance().log(tr("Canceled"));
+		return;
+	}
+
+	QStringList labels;
+	foreach (GIS::Vertex *v, shortestPath->vertices()) {
+		labels << v->label();
+	}
+	showTour(ui->acsResultView, labels);
 	ui->acsTotalLabel->setText(QString::number(shortestPath->totalCost()));
+	ui->acsGapLabel->setText(gapText(shortestPath->totalCost(), bound));
+	delete shortestPath;
+}
+
+void MainWindow::showAcsBestTour(const QStringList &labels, int length, int iteration)
+{
+	Q_UNUSED(iteration);
+	showTour(ui->acsResultView, labels);
+	ui->acsTotalLabel->setText(QString::number(length));
+}
+
+void MainWindow::showAcsProgress(int iteration, int bestLength, int msec)
+{
+	Q_UNUSED(bestLength);
+	ui->acsTimeLabel->setText(QString::number((double)msec/1000.0, 'f', 1) + "s, " + tr("iteration %1").arg(iteration));
 }
 
+// Also cancels a running brute force
 void MainWindow::runBruteForce()
 {
-	if (!m_graph) {
-		QMessageBox::warning(this, tr("Error"), tr("Load a graph first!"));
+	if (m_bfSolver->isRunning()) {
+		m_bfSolver->cancel();
 		return;
 	}
-	if (!m_graph->isConnected()) {
-		QMessageBox::critical(this, tr("Error"), tr("Graph is not connected!"));
+	if (!canSolve()) {
 		return;
 	}
-	QTime time;
-	time.start();
-	GIS::Path *shortestPath = m_graph->tspPath(GIS::Graph::BruteForce);
-	int msec = time.elapsed();
+	// in the order of solverCombo
+	static const GIS::Graph::TspType methods[] = {
+		GIS::Graph::BruteForce,
+		GIS::Graph::BranchAndBound,
+		GIS::Graph::HeldKarp,
+		GIS::Graph::NearestNeighbour,
+		GIS::Graph::GreedyEdge,
+		GIS::Graph::FarthestInsertion,
+		GIS::Graph::CheapestInsertion,
+		GIS::Graph::SpaceFillingCurve,
+		GIS::Graph::IteratedLocalSearch
+	};
+	m_graph->setInitialTour(m_lastTour);
+	ui->bfGapLabel->setText("-");
+	m_bfSolver->setLowerBound(ui->bfBoundCheck->isChecked());
+	m_bfSolver->solve(m_graph, methods[ui->solverCombo->currentIndex()]);
+	updateSolvingState();
+}
+
+void MainWindow::bruteForceFinished()
+{
+	updateSolvingState();
+	GIS::Path *shortestPath = m_bfSolver->takeResult();
+	int msec = m_bfSolver->elapsed();
+	double bound = m_bfSolver->lowerBound();
+	if (shortestPath && bound > 0) {
+		BFLogger::instance().log(tr("Lower bound: %1, gap: %2").arg(bound, 0, 'f', 1).arg(gapText(shortestPath->totalCost(), bound)));
+	}
+	if (shortestPath) {
+		m_lastTour = m_graph->lastTour();
+	}
 	BFLogger::instance().log(tr("Time elapsed: ") + QString::number((double)msec/1000.0, 'f', 3) + "s");
+	if (ui->bfStatsCheck->isChecked()) {
+		foreach (const QString &line, m_bfSolver->stats().toText()) {
+			BFLogger::instance().log(line);
+		}
+	}
 	BFLogger::instance().log("-------------------------------");
-	QStandardItemModel *model = 0;
-	if (ui->bfResultView->model()) {
-		model = static_cast<QStandardItemModel *>(ui->bfResultView->model());
-		model->clear();
-	} else {
-		model = new QStandardItemModel(ui->bfResultView);
-		ui->bfResultView->setModel(model);
+	ui->bfTimeLabel->setText(QString::number((double)msec/1000.0, 'f', 3) + "s");
+	if (!shortestPath) {
+		return;
 	}
+
+	QStringList labels;
 	foreach (GIS::Vertex *v, shortestPath->vertices()) {
-		model->appendRow(new QStandardItem(v->label()));
+		labels << v->label();
 	}
-	ui->bfTimeLabel->setText(QString::number((double)msec/1000.0, 'f', 3) + "s");
+	showTour(ui->bfResultView, labels);
 	ui->bfTotalLabel->setText(QString::number(shortestPath->totalCost()));
+	ui->bfGapLabel->setText(gapText(shortestPath->totalCost(), bound));
+	delete shortestPath;
 }
 
 void MainWindow::generateGraph()
@@ -167,3 +320,109 @@ void MainWindow::setBeta(double b)
 {
 	ACSParameters::instance().setBeta(b);
 }
+
+void MainWindow::setSeed(int seed)
+{
+	ACSParameters::instance().setSeed(seed);
+}
+
+void MainWindow::setLocalSearch(int type)
+{
+	ACSParameters::instance().setLocalSearch(type);
+}
+
+void MainWindow::setLocalSearchAllAnts(bool all)
+{
+	ACSParameters::instance().setLocalSearchAllAnts(all);
+}
+
+void MainWindow::setColonies(int colonies)
+{
+	ACSParameters::instance().setColonies(colonies);
+}
+
+void MainWindow::setMigrationInterval(int iterations)
+{
+	ACSParameters::instance().setMigrationInterval(iterations);
+}
+
+void MainWindow::setMigrationTopology(int topology)
+{
+	ACSParameters::instance().setMigrationTopology(topology);
+}
+
+void MainWindow::setIterations(int iterations)
+{
+	ACSParameters::instance().setIterations(iterations);
+}
+
+void MainWindow::setAnts(int ants)
+{
+	ACSParameters::instance().setAnts(ants);
+}
+
+void MainWindow::setTimeBudget(int msec)
+{
+	ACSParameters::instance().setTimeBudget(msec);
+}
+
+void MainWindow::setStagnationLimit(int iterations)
+{
+	ACSParameters::instance().setStagnationLimit(iterations);
+}
+
+void MainWindow::setQ0(double q0)
+{
+	ACSParameters::instance().setQ0(q0);
+}
+
+void MainWindow::setVariant(int variant)
+{
+	ACSParameters::instance().setVariant(variant);
+}
+
+void MainWindow::setAlpha(double a)
+{
+	ACSParameters::instance().setAlpha(a);
+}
+
+void MainWindow::setTrace(bool record)
+{
+	ACSParameters::instance().setTraceCapacity(record ? TraceCapacity : 0);
+}
+
+void MainWindow::exportTrace()
+{
+	QString filename = QFileDialog::getSaveFileName(this,
+													tr("Export trace..."),
+													QApplication::applicationDirPath(),
+													tr("CSV (*.csv);;JSON (*.json)"));
+	if (filename.isEmpty()) {
+		return;
+	}
+	if (!m_trace.save(filename)) {
+		QMessageBox::critical(this, tr("Error"),
+							  tr("Cannot save file: %1").arg(filename));
+	}
+}
+
+void MainWindow::setAutoPheromone(bool automatic)
+{
+	ACSParameters::instance().setAutoPheromoneZero(automatic);
+	ui->pheromoneSpin->setEnabled(!automatic);
+}
+
+void MainWindow::setMemoryBudget(int mb)
+{
+	ExactParameters::instance().setMemoryBudget(mb);
+}
+
+void MainWindow::setImprovementTimeLimit(int seconds)
+{
+	ExactParameters::instance().setImprovementTimeLimit(seconds);
+}
+
+void MainWindow::setTargetGap(double percent)
+{
+	ACSParameters::instance().setTargetGap(percent);
+}
@@ -5,6 +5,9 @@
 #include "graph.h"
 #include "graphmodel.h"
 
+class QAbstractItemView;
+class SolverThread;
+
 namespace Ui {
     class MainWindow;
 }
@@ -21,15 +24,55 @@ private slots:
 	void open();
 	void runAcs();
 	void runBruteForce();
+	void acsFinished();
+	void bruteForceFinished();
+	void showAcsBestTour(const QStringList &labels, int length, int iteration);
+	void showAcsProgress(int iteration, int bestLength, int msec);
 	void turnTuComplete();
 	void generateGraph();
 	void setPhi(double p);
 	void setBeta(double b);
 	void setPheromone(int ph);
+	void setSeed(int seed);
+	void setLocalSearch(int type);
+	void setLocalSearchAllAnts(bool all);
+	void setColonies(int colonies);
+	void setMigrationInterval(int iterations);
+	void setMigrationTopology(int topology);
+	void setIterations(int iterations);
+	void setAnts(int ants);
+	void setTimeBudget(int msec);
+	void setStagnationLimit(int iterations);
+	void setQ0(double q0);
+	void setVariant(int variant);
+	void setAlpha(double a);
+	void setAutoPheromone(bool automatic);
+	void setMemoryBudget(int mb);
+	void setImprovementTimeLimit(int seconds);
+	void setTargetGap(double percent);
+	void setTrace(bool record);
+	void exportTrace();
+private:
+	// samples of a recorded trace, long runs are thinned out to fit
+	static const int TraceCapacity = 4096;
+
+	bool canSolve();
+	void updateSolvingState();
+	void showTour(QAbstractItemView *view, const QStringList &labels);
+	static QString gapText(int length, double bound);
 private:
     Ui::MainWindow *ui;
 	GIS::Graph *m_graph;
 	GIS::GraphModel *m_model;
+	SolverThread *m_acsSolver;
+	SolverThread *m_bfSolver;
+	// trails and best tour of the last ACS run, kept across graph reloads
+	GIS::ACSSnapshot m_acsSnapshot;
+	// best tour of the last run of either panel, the initial tour of the
+	// exact panel's solvers
+	QStringList m_lastTour;
+	// of the last ACS run, empty unless recorded
+	GIS::ConvergenceTrace m_trace;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,234 @@
+#include "metricclosure.h"
+#include "graph.h"
+#include "canceltoken.h"
+
+#include <QThreadStorage>
+#include <QtConcurrentMap>
+#include <QtAlgorithms>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace GIS {
+
+struct ClosureSearch {
+	typedef void result_type;
+	ClosureSearch(MetricClosure *closure) : closure(closure) {}
+	void operator()(int source) const {
+		closure->search(source);
+	}
+	MetricClosure *closure;
+};
+
+static bool vertexLabelLessThan(Vertex *v1, Vertex *v2)
+{
+	return v1->label() < v2->label();
+}
+
+/*!
+\class CompressedGraph
+*/
+CompressedGraph::CompressedGraph(const Graph *graph)
+{
+	QList<Vertex *> verts = graph->vertices();
+	qSort(verts.begin(), verts.end(), vertexLabelLessThan);
+	vertices = QVector<Vertex *>::fromList(verts);
+	int n = vertices.size();
+	indices.reserve(n);
+	for (int v = 0; v < n; ++v) {
+		indices.insert(vertices.at(v), v);
+	}
+	firstEdge.resize(n + 1);
+	QVector<QPair<int, int> > row;
+	for (int v = 0; v < n; ++v) {
+		firstEdge[v] = targets.size();
+		row.clear();
+		foreach (Edge *e, vertices.at(v)->edges()) {
+			if (!e->isVirtual()) {
+				Vertex *other = e->startPoint() == vertices.at(v) ? e->endPoint() : e->startPoint();
+				row.append(qMakePair(indices.value(other), e->weight()));
+			}
+		}
+		qSort(row.begin(), row.end());
+		for (int i = 0; i < row.size(); ++i) {
+			targets.append(row.at(i).first);
+			weights.append(row.at(i).second);
+		}
+	}
+	firstEdge[n] = targets.size();
+}
+
+// Arrays of the searches of a thread, reused by its next searches: the
+// distances are Infinity and the predecessors -1 but for the touched
+// vertices of the running search
+struct SearchSpace
+{
+	void resize(int n)
+	{
+		if (distance.size() != n) {
+			distance.fill(DistanceMatrix::Infinity, n);
+			predecessor.fill(-1, n);
+		}
+	}
+
+	void reset()
+	{
+		foreach (int v, touched) {
+			distance[v] = DistanceMatrix::Infinity;
+			predecessor[v] = -1;
+		}
+		touched.clear();
+	}
+
+	QVector<int> distance;
+	QVector<int> predecessor;
+	QVector<int> touched;
+};
+
+static QThreadStorage<SearchSpace *> &searchSpaces()
+{
+	static QThreadStorage<SearchSpace *> storage;
+	return storage;
+}
+
+/*!
+\class MetricClosure
+*/
+MetricClosure::MetricClosure(const Graph *graph, const QList<Vertex *> &terminals)
+	: m_graph(graph)
+	, m_cancel(0)
+	, m_terminals(terminals)
+	, m_network(0)
+{
+}
+
+void MetricClosure::setCancelToken(const CancelToken *cancel)
+{
+	m_cancel = cancel;
+}
+
+bool MetricClosure::run()
+{
+	int k = size();
+	m_distances.fill(DistanceMatrix::Infinity, k * k);
+	m_trees.clear();
+	if (m_graph->isEuclidean()) {
+		for (int i = 0; i < k; ++i) {
+			for (int j = 0; j < k; ++j) {
+				m_distances[i * k + j] = m_graph->euclideanDistance(m_terminals.at(i), m_terminals.at(j));
+			}
+		}
+		return true;
+	}
+
+	m_network = m_graph->compressedEdges();
+	m_terminalVertices.resize(k);
+	m_vertexTerminals.clear();
+	for (int i = 0; i < k; ++i) {
+		m_terminalVertices[i] = m_network->indices.value(m_terminals.at(i));
+		m_vertexTerminals.insert(m_terminalVertices.at(i), i);
+	}
+
+	m_trees.resize(k);
+	QList<int> sources;
+	for (int i = 0; i < k; ++i) {
+		sources.append(i);
+	}
+	QtConcurrent::blockingMap(sources, ClosureSearch(this));
+	return !(m_cancel && m_cancel->isCanceled());
+}
+
+// Lazy deletion: a vertex may be queued several times, only the entry with
+// its final distance is expanded
+void MetricClosure::search(int source)
+{
+	typedef std::pair<int, int> Entry;
+	const CompressedGraph &network = *m_network;
+	int k = size();
+	SearchSpace *space = searchSpaces().localData();
+	if (!space) {
+		space = new SearchSpace;
+		searchSpaces().setLocalData(space);
+	}
+	space->resize(network.size());
+	QVector<int> &distance = space->distance;
+	QVector<int> &predecessor = space->predecessor;
+	int *row = m_distances.data() + source * k;
+
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+	int start = m_terminalVertices.at(source);
+	distance[start] = 0;
+	space->touched.append(start);
+	queue.push(Entry(0, start));
+	int unsettled = k;
+	int expanded = 0;
+	bool canceled = false;
+	while (!queue.empty() && unsettled > 0) {
+		Entry entry = queue.top();
+		queue.pop();
+		int v = entry.second;
+		if (entry.first > distance.at(v)) {
+			continue;
+		}
+		int terminal = m_vertexTerminals.value(v, -1);
+		if (terminal >= 0) {
+			row[terminal] = entry.first;
+			--unsettled;
+		}
+		if (++expanded % 1024 == 0 && m_cancel && m_cancel->isCanceled()) {
+			canceled = true;
+			break;
+		}
+		for (int e = network.firstEdge.at(v); e < network.firstEdge.at(v + 1); ++e) {
+			int w = network.targets.at(e);
+			int length = entry.first + network.weights.at(e);
+			if (length < distance.at(w)) {
+				if (distance.at(w) == DistanceMatrix::Infinity) {
+					space->touched.append(w);
+				}
+				distance[w] = length;
+				predecessor[w] = v;
+				queue.push(Entry(length, w));
+			}
+		}
+	}
+
+	// the shortest path tree pruned to the paths to the terminals
+	if (!canceled) {
+		QHash<int, int> &tree = m_trees[source];
+		for (int j = 0; j < k; ++j) {
+			if (row[j] >= DistanceMatrix::Infinity) {
+				continue;
+			}
+			for (int v = m_terminalVertices.at(j); v != start && !tree.contains(v); v = predecessor.at(v)) {
+				tree.insert(v, predecessor.at(v));
+			}
+		}
+	}
+	space->reset();
+}
+
+QList<Vertex *> MetricClosure::path(int i, int j) const
+{
+	QList<Vertex *> result;
+	if (distance(i, j) >= DistanceMatrix::Infinity) {
+		return result;
+	}
+	if (m_trees.isEmpty()) {
+		result << m_terminals.at(i);
+		if (i != j) {
+			result << m_terminals.at(j);
+		}
+		return result;
+	}
+	const QHash<int, int> &tree = m_trees.at(i);
+	int start = m_terminalVertices.at(i);
+	int v = m_terminalVertices.at(j);
+	for (; v != start; v = tree.value(v)) {
+		result.prepend(m_network->vertices.at(v));
+	}
+	result.prepend(m_network->vertices.at(start));
+	return result;
+}
+
+} // namespace GIS
@@ -0,0 +1,78 @@
+#ifndef METRICCLOSURE_H
+#define METRICCLOSURE_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+namespace GIS {
+
+class Graph;
+class Vertex;
+class CancelToken;
+struct ClosureSearch;
+
+// The real (not virtual) edges of a graph in compressed rows: the edges of
+// vertex v are [firstEdge[v], firstEdge[v + 1]). Vertices are ordered by
+// label and edges by target, so that ties between shortest paths do not
+// depend on hashing. Built once per graph, see Graph::compressedEdges().
+struct CompressedGraph
+{
+	explicit CompressedGraph(const Graph *graph);
+
+	int size() const { return vertices.size(); }
+
+	QVector<Vertex *> vertices;
+	QHash<Vertex *, int> indices;
+	QVector<int> firstEdge;
+	QVector<int> targets;
+	QVector<int> weights;
+};
+
+// Shortest paths among a few vertices (terminals) of a big graph, e.g. the
+// stops of a route in a road network. Every terminal is the source of one
+// Dijkstra search over the graph's CompressedGraph, stopped once all the
+// terminals are settled; the searches run in parallel. A search works in
+// arrays kept by its thread between queries and resets only the entries
+// it touched, and keeps only the predecessors on its paths to the
+// terminals, so a query costs what its searches explore, not the size of
+// the graph. The distances of a Euclidean graph are direct.
+class MetricClosure
+{
+public:
+	// The terminals must be distinct vertices of the graph
+	MetricClosure(const Graph *graph, const QList<Vertex *> &terminals);
+
+	void setCancelToken(const CancelToken *cancel);
+	// Returns false if canceled
+	bool run();
+
+	int size() const { return m_terminals.size(); }
+	Vertex *terminal(int i) const { return m_terminals.at(i); }
+	// DistanceMatrix::Infinity if there is no path
+	int distance(int i, int j) const { return m_distances.at(i * size() + j); }
+	// Vertices of a shortest path from terminal i to terminal j, both
+	// included; empty if there is none
+	QList<Vertex *> path(int i, int j) const;
+
+	friend struct ClosureSearch;
+
+private:
+	void search(int source);
+
+	const Graph *m_graph;
+	const CancelToken *m_cancel;
+	QList<Vertex *> m_terminals;
+	const CompressedGraph *m_network;
+	// vertex index of every terminal, terminal of those vertices
+	QVector<int> m_terminalVertices;
+	QHash<int, int> m_vertexTerminals;
+	QVector<int> m_distances;
+	// per search, the predecessors of the vertices on the shortest paths
+	// to the terminals
+	QVector<QHash<int, int> > m_trees;
+};
+
+} // namespace GIS
+
+#endif // METRICCLOSURE_H
@@ -0,0 +1,141 @@
+#include "multicolony.h"
+#include "graph.h"
+#include "random.h"
+
+#include <QtConcurrentMap>
+
+namespace GIS {
+
+struct InitColony {
+	typedef void result_type;
+	void operator()(ACS *colony) const {
+		colony->init();
+	}
+};
+
+struct IterateColony {
+	typedef void result_type;
+	IterateColony(int iterations) : iterations(iterations) {}
+	void operator()(ACS *colony) const {
+		colony->iterate(iterations);
+	}
+	int iterations;
+};
+
+/*!
+\class MultiColonyACS
+*/
+MultiColonyACS::MultiColonyACS(Graph *graph, int colonies, quint64 seed)
+	: m_observer(0)
+	, m_iteration(0)
+{
+	for (int i = 0; i < colonies; ++i) {
+		m_colonies.append(new ACS(graph, Random::deriveSeed(seed, i)));
+	}
+}
+
+MultiColonyACS::~MultiColonyACS()
+{
+	qDeleteAll(m_colonies);
+}
+
+void MultiColonyACS::setObserver(ACSObserver *observer)
+{
+	m_observer = observer;
+}
+
+void MultiColonyACS::setCancelToken(const CancelToken *cancel)
+{
+	foreach (ACS *colony, m_colonies) {
+		colony->setCancelToken(cancel);
+	}
+}
+
+Tour *MultiColonyACS::acs(int migrationInterval, Topology topology)
+{
+	QtConcurrent::blockingMap(m_colonies, InitColony());
+
+	if (migrationInterval <= 0) {
+		migrationInterval = 1;
+	}
+	m_iteration = 0;
+	int bestLength = INT_MAX;
+	forever {
+		QtConcurrent::blockingMap(m_colonies, IterateColony(migrationInterval));
+		m_iteration += migrationInterval;
+
+		Tour *best = globalBest();
+		if (!best->isEmpty() && best->length() < bestLength) {
+			bestLength = best->length();
+			if (m_observer) {
+				m_observer->tourImproved(best, m_iteration);
+			}
+		}
+		if (m_observer) {
+			m_observer->iterationFinished(m_iteration, bestLength);
+		}
+
+		bool finished = true;
+		foreach (ACS *colony, m_colonies) {
+			finished = finished && colony->isFinished();
+		}
+		if (finished) {
+			break;
+		}
+		migrate(topology);
+	}
+	return globalBest();
+}
+
+void MultiColonyACS::setWarmStart(const ACSSnapshot &snapshot)
+{
+	foreach (ACS *colony, m_colonies) {
+		colony->setWarmStart(snapshot);
+	}
+}
+
+ACSSnapshot MultiColonyACS::snapshot() const
+{
+	return m_colonies.at(bestColony())->snapshot();
+}
+
+Tour *MultiColonyACS::globalBest() const
+{
+	return m_colonies.at(bestColony())->bestTour();
+}
+
+// A colony canceled before its first iteration has no tour yet
+int MultiColonyACS::bestColony() const
+{
+	int best = 0;
+	for (int i = 1; i < m_colonies.size(); ++i) {
+		Tour *t = m_colonies.at(i)->bestTour();
+		Tour *b = m_colonies.at(best)->bestTour();
+		if (!t->isEmpty() && (b->isEmpty() || t->length() < b->length())) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+// Tours are sent from a snapshot taken before any colony receives one
+void MultiColonyACS::migrate(Topology topology)
+{
+	QList<Tour> bests;
+	int globalBest = 0;
+	for (int i = 0; i < m_colonies.size(); ++i) {
+		bests.append(*m_colonies.at(i)->bestTour());
+		if (bests[i].length() < bests[globalBest].length()) {
+			globalBest = i;
+		}
+	}
+
+	for (int i = 0; i < m_colonies.size(); ++i) {
+		int from = topology == Ring ? (i + m_colonies.size() - 1) % m_colonies.size() : globalBest;
+		if (from != i) {
+			m_colonies.at(i)->acceptTour(&bests[from]);
+		}
+	}
+}
+
+} // namespace GIS
@@ -0,0 +1,53 @@
+#ifndef MULTICOLONY_H
+#define MULTICOLONY_H
+
+#include <QList>
+#include <QtGlobal>
+
+namespace GIS {
+
+class ACS;
+class ACSObserver;
+class CancelToken;
+struct ACSSnapshot;
+class Graph;
+class Tour;
+
+// Island model: N independent ACS colonies, each with its own pheromone
+// matrix, run in parallel and exchange their best tours every M iterations.
+// Colonies are synchronised at every migration, so for a given master seed
+// the result does not depend on the number of threads.
+class MultiColonyACS
+{
+public:
+	enum Topology {
+		Ring,
+		FullyConnected
+	};
+
+	MultiColonyACS(Graph *graph, int colonies, quint64 seed);
+	~MultiColonyACS();
+
+	// Runs until every colony meets its stop criteria (see ACS::isFinished())
+	Tour *acs(int migrationInterval, Topology topology);
+	// Notified of global best improvements, at migration points
+	void setObserver(ACSObserver *observer);
+	// Passed on to every colony
+	void setCancelToken(const CancelToken *cancel);
+	void setWarmStart(const ACSSnapshot &snapshot);
+	// Snapshot of the colony holding the global best tour
+	ACSSnapshot snapshot() const;
+
+private:
+	Tour *globalBest() const;
+	int bestColony() const;
+	void migrate(Topology topology);
+
+	QList<ACS *> m_colonies;
+	ACSObserver *m_observer;
+	int m_iteration;
+};
+
+} // namespace GIS
+
+#endif // MULTICOLONY_H
@@ -0,0 +1,88 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <QtGlobal>
+
+namespace GIS {
+
+// xoshiro256++ pseudo random number generator (Blackman, Vigna).
+// State is initialised with splitmix64 from (seed, stream), so every solver
+// component can draw from its own independent stream derived from one
+// master seed - results then do not depend on scheduling or thread count.
+class Random
+{
+public:
+	explicit Random(quint64 seed = 0, quint64 stream = 0)
+	{
+		setSeed(seed, stream);
+	}
+
+	void setSeed(quint64 seed, quint64 stream = 0)
+	{
+		quint64 x = deriveSeed(seed, stream);
+		for (int i = 0; i < 4; ++i) {
+			m_s[i] = splitMix(x);
+		}
+	}
+
+	// Seed of sub-stream "stream" of master seed "seed"
+	static quint64 deriveSeed(quint64 seed, quint64 stream)
+	{
+		quint64 x = stream;
+		return seed ^ splitMix(x);
+	}
+
+	quint64 next()
+	{
+		const quint64 result = rotl(m_s[0] + m_s[3], 23) + m_s[0];
+		const quint64 t = m_s[1] << 17;
+		m_s[2] ^= m_s[0];
+		m_s[3] ^= m_s[1];
+		m_s[1] ^= m_s[2];
+		m_s[0] ^= m_s[3];
+		m_s[2] ^= t;
+		m_s[3] = rotl(m_s[3], 45);
+		return result;
+	}
+
+	// Uniform double in [0, 1) with 53 bits of precision
+	double nextDouble()
+	{
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// Uniform integer in [0, bound), Lemire's nearly divisionless method
+	quint32 nextInt(quint32 bound)
+	{
+		quint64 m = (next() >> 32) * bound;
+		quint32 l = quint32(m);
+		if (l < bound) {
+			quint32 t = (0u - bound) % bound;
+			while (l < t) {
+				m = (next() >> 32) * bound;
+				l = quint32(m);
+			}
+		}
+		return quint32(m >> 32);
+	}
+
+private:
+	static quint64 rotl(quint64 x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+	static quint64 splitMix(quint64 &x)
+	{
+		quint64 z = (x += Q_UINT64_C(0x9E3779B97F4A7C15));
+		z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+		z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+		return z ^ (z >> 31);
+	}
+
+	quint64 m_s[4];
+};
+
+} // namespace GIS
+
+#endif // RANDOM_H
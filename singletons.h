@@ -1,57 +1,96 @@
 #ifndef SINGLETONS_H
 #define SINGLETONS_H
 
-#include <QPlainTextEdit>
+#include <QObject>
+#include <QThreadStorage>
 
+#include "logging.h"
+
+// Front of the BruteForce channel of GIS::Log: the records go to the
+// receiver once the log's thread gets to them
 class BFLogger
 {
 private:
-	BFLogger() : m_pte(0) {}
+	BFLogger() : m_sink(0) {}
 	BFLogger(const BFLogger &other) { Q_UNUSED(other); }
 public:
 	static BFLogger &instance() {
 		static BFLogger logger;
 		return logger;
 	}
-	void setPlainTextEdit(QPlainTextEdit *pte) { m_pte = pte; }
+	// Any object with an appendPlainText(QString) slot, e.g. a
+	// QPlainTextEdit, 0 for none; reset it before the receiver is deleted
+	void setReceiver(QObject *receiver) {
+		if (m_sink) {
+			GIS::Log::instance().removeSink(m_sink);
+		}
+		m_sink = receiver ? new GIS::ReceiverSink(receiver, GIS::Log::BruteForce) : 0;
+		if (m_sink) {
+			GIS::Log::instance().addSink(m_sink);
+		}
+	}
+	// Safe from solver threads, never blocks
 	void log(const QString &string) {
-		m_pte->appendPlainText(string);
+		GIS_LOG(Info, BruteForce, string);
 	}
 
 private:
-	QPlainTextEdit *m_pte;
+	GIS::ReceiverSink *m_sink;
 };
 
+// The AntColony channel, see BFLogger
 class ACSLogger
 {
 private:
-	ACSLogger() : m_pte(0) {}
-	ACSLogger(const BFLogger &other) { Q_UNUSED(other); }
+	ACSLogger() : m_sink(0) {}
+	ACSLogger(const ACSLogger &other) { Q_UNUSED(other); }
 public:
 	static ACSLogger &instance() {
 		static ACSLogger logger;
 		return logger;
 	}
 
-	void setPlainTextEdit(QPlainTextEdit *pte) { m_pte = pte; }
+	void setReceiver(QObject *receiver) {
+		if (m_sink) {
+			GIS::Log::instance().removeSink(m_sink);
+		}
+		m_sink = receiver ? new GIS::ReceiverSink(receiver, GIS::Log::AntColony) : 0;
+		if (m_sink) {
+			GIS::Log::instance().addSink(m_sink);
+		}
+	}
 	void log(const QString &string) {
-		m_pte->appendPlainText(string);
+		GIS_LOG(Info, AntColony, string);
 	}
 private:
-	QPlainTextEdit *m_pte;
+	GIS::ReceiverSink *m_sink;
 };
 
+// The solvers read instance(). Copies carry the parameters of a single
+// job, see setThreadInstance().
 class ACSParameters
 {
-private:
-	ACSParameters() : m_beta(0.6), m_phi(0.9), m_pheromone0(10) {}
-	ACSParameters(const ACSParameters &other) { Q_UNUSED(other); }
 public:
+	ACSParameters() : m_beta(0.6), m_phi(0.9), m_pheromone0(10), m_seed(0), m_localSearch(0), m_localSearchAllAnts(false)
+	  , m_colonies(1), m_migrationInterval(1), m_migrationTopology(0)
+	  , m_iterations(5), m_ants(10), m_timeBudget(0), m_stagnationLimit(0), m_q0(0)
+	  , m_variant(0), m_alpha(0.6), m_rankWeight(6), m_autoPheromoneZero(false), m_targetGap(-1)
+	  , m_traceCapacity(0) {}
+
 	static ACSParameters &instance() {
+		if (ACSParameters *params = threadInstances().localData()) {
+			return *params;
+		}
 		static ACSParameters params;
 		return params;
 	}
 
+	// Replaces instance() in the calling thread until called again, 0 goes
+	// back to the shared one; takes ownership
+	static void setThreadInstance(ACSParameters *params) {
+		threadInstances().setLocalData(params);
+	}
+
 	void setBeta(double b) {
 		m_beta = b;
 	}
@@ -76,10 +115,234 @@ public:
 		return m_pheromone0;
 	}
 
+	// Use tau0 = 1 / (n Lnn), Lnn the length of the nearest neighbour tour,
+	// instead of pheromoneZero()
+	void setAutoPheromoneZero(bool automatic) {
+		m_autoPheromoneZero = automatic;
+	}
+
+	bool autoPheromoneZero() const {
+		return m_autoPheromoneZero;
+	}
+
+	// Master seed, every ant draws from its own stream derived from it
+	void setSeed(quint64 seed) {
+		m_seed = seed;
+	}
+
+	quint64 seed() const {
+		return m_seed;
+	}
+
+	// GIS::LocalSearch::Type applied to the constructed tours
+	void setLocalSearch(int type) {
+		m_localSearch = type;
+	}
+
+	int localSearch() const {
+		return m_localSearch;
+	}
+
+	// Improve every ant's tour instead of the iteration-best one only
+	void setLocalSearchAllAnts(bool all) {
+		m_localSearchAllAnts = all;
+	}
+
+	bool localSearchAllAnts() const {
+		return m_localSearchAllAnts;
+	}
+
+	// Number of independent colonies (island model), 1 runs a single ACS
+	void setColonies(int colonies) {
+		m_colonies = colonies;
+	}
+
+	int colonies() const {
+		return m_colonies;
+	}
+
+	// Iterations between exchanges of the colonies' best tours
+	void setMigrationInterval(int iterations) {
+		m_migrationInterval = iterations;
+	}
+
+	int migrationInterval() const {
+		return m_migrationInterval;
+	}
+
+	// GIS::MultiColonyACS::Topology used for the exchange
+	void setMigrationTopology(int topology) {
+		m_migrationTopology = topology;
+	}
+
+	int migrationTopology() const {
+		return m_migrationTopology;
+	}
+
+	// Stop criteria of a run, 0 disables a criterion
+	void setIterations(int iterations) {
+		m_iterations = iterations;
+	}
+
+	int iterations() const {
+		return m_iterations;
+	}
+
+	// Wall-clock budget in milliseconds
+	void setTimeBudget(int msec) {
+		m_timeBudget = msec;
+	}
+
+	int timeBudget() const {
+		return m_timeBudget;
+	}
+
+	// Iterations without improvement of the best tour
+	void setStagnationLimit(int iterations) {
+		m_stagnationLimit = iterations;
+	}
+
+	int stagnationLimit() const {
+		return m_stagnationLimit;
+	}
+
+	// Probability of taking the most desirable vertex instead of a roulette
+	// draw, 0 is the plain random proportional rule
+	void setQ0(double q0) {
+		m_q0 = q0;
+	}
+
+	double q0() const {
+		return m_q0;
+	}
+
+	// GIS::ColonyParameters::Variant: ACS, MAX-MIN or rank-based Ant System
+	void setVariant(int variant) {
+		m_variant = variant;
+	}
+
+	int variant() const {
+		return m_variant;
+	}
+
+	// Evaporation of the global update (rho for MMAS and rank-based AS)
+	void setAlpha(double a) {
+		m_alpha = a;
+	}
+
+	double alpha() const {
+		return m_alpha;
+	}
+
+	// Rank-based AS: the best rankWeight - 1 ants deposit pheromone
+	void setRankWeight(int w) {
+		m_rankWeight = w;
+	}
+
+	int rankWeight() const {
+		return m_rankWeight;
+	}
+
+	// Stops once the best tour is within this many percent of the Held-Karp
+	// lower bound, negative is off
+	void setTargetGap(double percent) {
+		m_targetGap = percent;
+	}
+
+	double targetGap() const {
+		return m_targetGap;
+	}
+
+	// Samples of the GIS::ConvergenceTrace a run leaves in the
+	// GIS::SolveStats of its thread, 0 records none
+	void setTraceCapacity(int samples) {
+		m_traceCapacity = samples;
+	}
+
+	int traceCapacity() const {
+		return m_traceCapacity;
+	}
+
+	void setAnts(int ants) {
+		m_ants = ants;
+	}
+
+	int ants() const {
+		return m_ants;
+	}
+
 private:
 	double m_beta;
 	double m_phi;
 	int m_pheromone0;
+	quint64 m_seed;
+	int m_localSearch;
+	bool m_localSearchAllAnts;
+	int m_colonies;
+	int m_migrationInterval;
+	int m_migrationTopology;
+	int m_iterations;
+	int m_ants;
+	int m_timeBudget;
+	int m_stagnationLimit;
+	double m_q0;
+	int m_variant;
+	double m_alpha;
+	int m_rankWeight;
+	bool m_autoPheromoneZero;
+	double m_targetGap;
+	int m_traceCapacity;
+
+	static QThreadStorage<ACSParameters *> &threadInstances() {
+		static QThreadStorage<ACSParameters *> storage;
+		return storage;
+	}
+};
+
+// Like ACSParameters
+class ExactParameters
+{
+public:
+	ExactParameters() : m_memoryBudget(1024), m_improvementTimeLimit(5) {}
+
+	static ExactParameters &instance() {
+		if (ExactParameters *params = threadInstances().localData()) {
+			return *params;
+		}
+		static ExactParameters params;
+		return params;
+	}
+
+	static void setThreadInstance(ExactParameters *params) {
+		threadInstances().setLocalData(params);
+	}
+
+	// Megabytes the Held-Karp tables may take, larger instances are refused
+	void setMemoryBudget(int mb) {
+		m_memoryBudget = mb;
+	}
+
+	int memoryBudget() const {
+		return m_memoryBudget;
+	}
+
+	// Seconds the iterated local search keeps kicking its tour
+	void setImprovementTimeLimit(int seconds) {
+		m_improvementTimeLimit = seconds;
+	}
+
+	int improvementTimeLimit() const {
+		return m_improvementTimeLimit;
+	}
+
+private:
+	int m_memoryBudget;
+	int m_improvementTimeLimit;
+
+	static QThreadStorage<ExactParameters *> &threadInstances() {
+		static QThreadStorage<ExactParameters *> storage;
+		return storage;
+	}
 };
 
 #endif // SINGLETONS_H
@@ -0,0 +1,123 @@
+#include "solverthread.h"
+
+SolverThread::SolverThread(QObject *parent)
+	: QThread(parent)
+	, m_graph(0)
+	, m_type(GIS::Graph::BruteForce)
+	, m_result(0)
+	, m_elapsed(0)
+	, m_computeLowerBound(false)
+	, m_lowerBound(-1)
+	, m_pendingTour(0)
+	, m_pendingIteration(0)
+	, m_lastTourReport(0)
+	, m_lastProgressReport(0)
+{
+}
+
+SolverThread::~SolverThread()
+{
+	cancel();
+	wait();
+	delete m_result;
+}
+
+void SolverThread::solve(GIS::Graph *graph, GIS::Graph::TspType type)
+{
+	if (isRunning()) {
+		return;
+	}
+	m_graph = graph;
+	m_type = type;
+	m_acsParameters = ACSParameters::instance();
+	m_exactParameters = ExactParameters::instance();
+	m_cancel.reset();
+	delete m_result;
+	m_result = 0;
+	start();
+}
+
+GIS::Path *SolverThread::takeResult()
+{
+	GIS::Path *result = m_result;
+	m_result = 0;
+	return result;
+}
+
+int SolverThread::elapsed() const
+{
+	return m_elapsed;
+}
+
+void SolverThread::setLowerBound(bool compute)
+{
+	m_computeLowerBound = compute;
+}
+
+double SolverThread::lowerBound() const
+{
+	return m_lowerBound;
+}
+
+const GIS::SolveStats &SolverThread::stats() const
+{
+	return m_stats;
+}
+
+void SolverThread::cancel()
+{
+	m_cancel.cancel();
+}
+
+void SolverThread::run()
+{
+	m_pendingTour = 0;
+	m_lastTourReport = -ProgressInterval;
+	m_lastProgressReport = -ProgressInterval;
+	m_stats.clear();
+	ACSParameters::setThreadInstance(new ACSParameters(m_acsParameters));
+	ExactParameters::setThreadInstance(new ExactParameters(m_exactParameters));
+	m_timer.start();
+	{
+		GIS::StatsScope scope(&m_stats);
+		m_result = m_graph->tspPath(m_type, this, &m_cancel);
+	}
+	m_elapsed = m_timer.elapsed();
+	ACSParameters::setThreadInstance(0);
+	ExactParameters::setThreadInstance(0);
+	m_lowerBound = m_result && m_computeLowerBound ? m_graph->lowerBound(&m_cancel) : -1;
+}
+
+void SolverThread::tourImproved(GIS::Tour *best, int iteration)
+{
+	m_pendingTour = best;
+	m_pendingIteration = iteration;
+	reportBestTour();
+}
+
+// Also flushes an improvement held back by the throttling
+void SolverThread::iterationFinished(int iteration, int bestLength)
+{
+	qint64 now = m_timer.elapsed();
+	if (now - m_lastProgressReport >= ProgressInterval) {
+		m_lastProgressReport = now;
+		emit progress(iteration, bestLength, now);
+	}
+	reportBestTour();
+}
+
+void SolverThread::reportBestTour()
+{
+	qint64 now = m_timer.elapsed();
+	if (!m_pendingTour || now - m_lastTourReport < ProgressInterval) {
+		return;
+	}
+	m_lastTourReport = now;
+
+	QStringList labels;
+	foreach (GIS::Vertex *v, m_pendingTour->vertices()) {
+		labels << v->label();
+	}
+	emit bestTourChanged(labels, m_pendingTour->length(), m_pendingIteration);
+	m_pendingTour = 0;
+}
@@ -0,0 +1,77 @@
+#ifndef SOLVERTHREAD_H
+#define SOLVERTHREAD_H
+
+#include <QThread>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "graph.h"
+#include "canceltoken.h"
+#include "singletons.h"
+
+// Runs Graph::tspPath() off the GUI thread. The best-so-far tour and the
+// iteration count of an ACS run are sent through queued signals, each at
+// most once per ProgressInterval milliseconds.
+class SolverThread : public QThread, private GIS::ACSObserver
+{
+	Q_OBJECT
+public:
+	static const int ProgressInterval = 200;
+
+	SolverThread(QObject *parent = 0);
+	~SolverThread();
+
+	// The graph must not be modified until finished() is emitted. The run
+	// uses a copy of ACSParameters and ExactParameters taken here, so the
+	// parameters may be changed while it goes on.
+	void solve(GIS::Graph *graph, GIS::Graph::TspType type);
+	// The path found by the last run, 0 if it was canceled before finding
+	// one. The caller takes ownership.
+	GIS::Path *takeResult();
+	// Duration of the last run in milliseconds
+	int elapsed() const;
+	// Whether the next runs also compute Graph::lowerBound() once the
+	// solver is done; off by default as the ascent can take longer than
+	// the solve
+	void setLowerBound(bool compute);
+	// Graph::lowerBound() of the graph solved by the last run; -1 if it was
+	// not asked for, if the run found no path or the bound is unknown
+	double lowerBound() const;
+	// Phases and counters of the last run, without the lower bound
+	const GIS::SolveStats &stats() const;
+
+public slots:
+	void cancel();
+
+signals:
+	void bestTourChanged(const QStringList &labels, int length, int iteration);
+	void progress(int iteration, int bestLength, int msec);
+
+protected:
+	void run();
+
+private:
+	void tourImproved(GIS::Tour *best, int iteration);
+	void iterationFinished(int iteration, int bestLength);
+	void reportBestTour();
+
+	GIS::Graph *m_graph;
+	GIS::Graph::TspType m_type;
+	ACSParameters m_acsParameters;
+	ExactParameters m_exactParameters;
+	GIS::CancelToken m_cancel;
+	GIS::Path *m_result;
+	QElapsedTimer m_timer;
+	int m_elapsed;
+	bool m_computeLowerBound;
+	double m_lowerBound;
+	GIS::SolveStats m_stats;
+	// improvement not sent yet because of the throttling; the tour is owned
+	// by the solver and only read from the solving thread
+	GIS::Tour *m_pendingTour;
+	int m_pendingIteration;
+	qint64 m_lastTourReport;
+	qint64 m_lastProgressReport;
+};
+
+#endif // SOLVERTHREAD_H
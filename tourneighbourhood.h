@@ -0,0 +1,201 @@
+#ifndef TOURNEIGHBOURHOOD_H
+#define TOURNEIGHBOURHOOD_H
+
+#include <QVector>
+
+#include "distancematrix.h"
+
+namespace GIS {
+
+// 2-opt / Or-opt moves restricted to candidate neighbour lists, driven by a
+// queue of vertices whose don't-look bit is cleared. Shared by the local
+// searches, whatever their tour representation: Tour is the class deriving
+// from this one, which provides
+//   int succ(int v, bool forward) const;
+//   void make2OptMove(int a, int b, int c, int e);
+// the latter replacing edges (a,b) and (c,e) with (a,c) and (b,e), where
+// a->b->...->c->e is the tour in one of its two directions.
+template <class Tour>
+class TourNeighbourhood
+{
+protected:
+	TourNeighbourhood(const DistanceMatrix *distances, int neighbours);
+
+	int d(int a, int b) const { return m_distances->distance(a, b); }
+
+	// Empties the queue and clears the don't-look bit of every vertex of the
+	// tour
+	void queueAll(const QVector<int> &tour);
+	void push(int v);
+	// The next vertex to search from, -1 once the queue is empty
+	int pop();
+
+	bool improveTwoOpt(int a);
+	bool improveOrOpt(int a);
+
+	const DistanceMatrix *m_distances;
+	QVector<int> m_neighbours;
+	int m_k;
+	int m_n;
+
+private:
+	int succ(int v, bool forward) const { return static_cast<const Tour *>(this)->succ(v, forward); }
+	void make2OptMove(int a, int b, int c, int e) { static_cast<Tour *>(this)->make2OptMove(a, b, c, e); }
+
+	QVector<int> m_queue;
+	QVector<bool> m_queued;
+	int m_queueHead;
+	int m_queueSize;
+};
+
+template <class Tour>
+TourNeighbourhood<Tour>::TourNeighbourhood(const DistanceMatrix *distances, int neighbours)
+	: m_distances(distances)
+	, m_k(0)
+	, m_n(distances->size())
+	, m_queueHead(0)
+	, m_queueSize(0)
+{
+	m_neighbours = distances->neighbourLists(neighbours);
+	if (m_n > 1) {
+		m_k = m_neighbours.size() / m_n;
+	}
+	m_queue.resize(m_n);
+	m_queued.resize(m_n);
+}
+
+template <class Tour>
+void TourNeighbourhood<Tour>::queueAll(const QVector<int> &tour)
+{
+	m_queueHead = 0;
+	m_queueSize = 0;
+	m_queued.fill(false);
+	for (int i = 0; i < tour.size(); ++i) {
+		push(tour.at(i));
+	}
+}
+
+template <class Tour>
+void TourNeighbourhood<Tour>::push(int v)
+{
+	if (m_queued.at(v)) {
+		return;
+	}
+	m_queued[v] = true;
+	m_queue[(m_queueHead + m_queueSize) % m_n] = v;
+	++m_queueSize;
+}
+
+template <class Tour>
+int TourNeighbourhood<Tour>::pop()
+{
+	if (!m_queueSize) {
+		return -1;
+	}
+	int v = m_queue.at(m_queueHead);
+	m_queueHead = (m_queueHead + 1) % m_n;
+	--m_queueSize;
+	m_queued[v] = false;
+	return v;
+}
+
+// Replaces edges (a,b) and (c,e) with (a,c) and (b,e), where a->b->...->c->e
+// is the tour in one of its two directions
+template <class Tour>
+bool TourNeighbourhood<Tour>::improveTwoOpt(int a)
+{
+	for (int dir = 0; dir < 2; ++dir) {
+		bool forward = dir == 0;
+		int b = succ(a, forward);
+		int dab = d(a, b);
+		for (int i = 0; i < m_k; ++i) {
+			int c = m_neighbours.at(a * m_k + i);
+			int dac = d(a, c);
+			if (dac >= dab) {
+				break;
+			}
+			int e = succ(c, forward);
+			if (c == b || e == a) {
+				continue;
+			}
+			if (dac + d(b, e) < dab + d(c, e)) {
+				make2OptMove(a, b, c, e);
+				push(a);
+				push(b);
+				push(c);
+				push(e);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Moves segment s1..s2 (1 to 3 vertices starting at a, in either direction)
+// between two adjacent vertices x and y close to one of its ends, optionally
+// reversing it
+template <class Tour>
+bool TourNeighbourhood<Tour>::improveOrOpt(int a)
+{
+	for (int len = 1; len <= 3 && len + 3 <= m_n; ++len) {
+		for (int dir = 0; dir < 2; ++dir) {
+			bool forward = dir == 0;
+			int s1 = a;
+			int s2 = a;
+			for (int i = 1; i < len; ++i) {
+				s2 = succ(s2, forward);
+			}
+			int p = succ(s1, !forward);
+			int n = succ(s2, forward);
+			int removeGain = d(p, s1) + d(s2, n) - d(p, n);
+			if (removeGain <= 0) {
+				continue;
+			}
+
+			for (int end = 0; end < 2; ++end) {
+				int s = end == 0 ? s1 : s2;
+				for (int i = 0; i < m_k; ++i) {
+					int c = m_neighbours.at(s * m_k + i);
+					if (d(s, c) >= removeGain) {
+						break;
+					}
+					for (int side = 0; side < 2; ++side) {
+						int x = side == 0 ? c : succ(c, !forward);
+						if (x == p || x == s1 || x == s2 || (len == 3 && x == succ(s1, forward))) {
+							continue;
+						}
+						int y = succ(x, forward);
+						int dxy = d(x, y);
+						int addReversed = d(x, s2) + d(s1, y) - dxy;
+						int addForward = d(x, s1) + d(s2, y) - dxy;
+						bool reversed = addReversed < addForward;
+						if ((reversed ? addReversed : addForward) >= removeGain) {
+							continue;
+						}
+
+						// p->s1..s2->n->..->x->y  =>  p->n->..->x->s2..s1->y
+						make2OptMove(p, s1, x, y);
+						if (x != n) {
+							make2OptMove(p, x, n, s2);
+						}
+						if (!reversed && s1 != s2) {
+							make2OptMove(x, s2, s1, y);
+						}
+						push(p);
+						push(n);
+						push(s1);
+						push(s2);
+						push(x);
+						push(y);
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+} // namespace GIS
+
+#endif // TOURNEIGHBOURHOOD_H
@@ -0,0 +1,244 @@
+#include "twolevellist.h"
+
+#include <qmath.h>
+
+namespace GIS {
+
+/*!
+\class TwoLevelList
+*/
+TwoLevelList::TwoLevelList()
+	: m_n(0)
+	, m_groupSize(0)
+{
+}
+
+void TwoLevelList::setTour(const QVector<int> &tour)
+{
+	m_n = tour.size();
+	m_groupSize = qMax(8, int(qSqrt(m_n)));
+	m_segments.clear();
+	m_freeSegments.clear();
+	m_order.clear();
+	m_segment.resize(m_n);
+	m_index.resize(m_n);
+	for (int i = 0; i < m_n; i += m_groupSize) {
+		Segment s;
+		s.vertices = tour.mid(i, m_groupSize);
+		s.reversed = false;
+		s.rank = m_order.size();
+		m_order.append(m_segments.size());
+		m_segments.append(s);
+		reindex(m_segments.size() - 1);
+	}
+}
+
+int TwoLevelList::next(int v) const
+{
+	int s = m_segment.at(v);
+	const Segment &segment = m_segments.at(s);
+	int i = m_index.at(v);
+	if (!segment.reversed) {
+		if (i + 1 < segment.vertices.size()) {
+			return segment.vertices.at(i + 1);
+		}
+	} else if (i > 0) {
+		return segment.vertices.at(i - 1);
+	}
+	return first(nextSegment(s));
+}
+
+int TwoLevelList::prev(int v) const
+{
+	int s = m_segment.at(v);
+	const Segment &segment = m_segments.at(s);
+	int i = m_index.at(v);
+	if (segment.reversed) {
+		if (i + 1 < segment.vertices.size()) {
+			return segment.vertices.at(i + 1);
+		}
+	} else if (i > 0) {
+		return segment.vertices.at(i - 1);
+	}
+	const Segment &previous = m_segments.at(prevSegment(s));
+	return previous.reversed ? previous.vertices.first() : previous.vertices.last();
+}
+
+void TwoLevelList::reverse(int from, int to)
+{
+	if (from == to || next(to) == from) {
+		return;
+	}
+	splitBefore(from);
+	splitBefore(next(to));
+
+	int segments = m_order.size();
+	int i = m_segments.at(m_segment.at(from)).rank;
+	int j = m_segments.at(m_segment.at(to)).rank;
+	int count = j - i + 1;
+	if (count <= 0) {
+		count += segments;
+	}
+	if (2 * count > segments) {
+		// the rest of the tour, not empty as next(to) != from
+		int k = j + 1 == segments ? 0 : j + 1;
+		j = i == 0 ? segments - 1 : i - 1;
+		i = k;
+		count = segments - count;
+	}
+	for (int k = 0; k < count; ++k) {
+		if (2 * k < count - 1) {
+			qSwap(m_order[i], m_order[j]);
+			m_segments[m_order.at(j)].rank = j;
+			if (--j < 0) {
+				j = segments - 1;
+			}
+		}
+		Segment &segment = m_segments[m_order.at(i)];
+		segment.rank = i;
+		segment.reversed = !segment.reversed;
+		if (++i == segments) {
+			i = 0;
+		}
+	}
+
+	mergeAround(from);
+	mergeAround(to);
+}
+
+QVector<int> TwoLevelList::tour(int start) const
+{
+	QVector<int> result(m_n);
+	int v = start;
+	for (int i = 0; i < m_n; ++i) {
+		result[i] = v;
+		v = next(v);
+	}
+	return result;
+}
+
+int TwoLevelList::first(int s) const
+{
+	const Segment &segment = m_segments.at(s);
+	return segment.reversed ? segment.vertices.last() : segment.vertices.first();
+}
+
+int TwoLevelList::nextSegment(int s) const
+{
+	int rank = m_segments.at(s).rank + 1;
+	return m_order.at(rank == m_order.size() ? 0 : rank);
+}
+
+int TwoLevelList::prevSegment(int s) const
+{
+	int rank = m_segments.at(s).rank;
+	return m_order.at(rank == 0 ? m_order.size() - 1 : rank - 1);
+}
+
+// Makes v the first vertex of its segment, the vertices from v on move to a
+// new segment following it
+void TwoLevelList::splitBefore(int v)
+{
+	int s = m_segment.at(v);
+	if (first(s) == v) {
+		return;
+	}
+	Segment tail;
+	int i = m_index.at(v);
+	if (!m_segments.at(s).reversed) {
+		tail.vertices = m_segments.at(s).vertices.mid(i);
+		tail.reversed = false;
+		m_segments[s].vertices.resize(i);
+	} else {
+		tail.vertices = m_segments.at(s).vertices.mid(0, i + 1);
+		tail.reversed = true;
+		m_segments[s].vertices.remove(0, i + 1);
+		reindex(s);
+	}
+
+	int t;
+	if (m_freeSegments.isEmpty()) {
+		t = m_segments.size();
+		m_segments.append(tail);
+	} else {
+		t = m_freeSegments.last();
+		m_freeSegments.remove(m_freeSegments.size() - 1);
+		m_segments[t] = tail;
+	}
+	reindex(t);
+	insertSegment(m_segments.at(s).rank + 1, t);
+}
+
+// Merges the segment of v with its neighbours while they fit in one group
+void TwoLevelList::mergeAround(int v)
+{
+	if (m_order.size() < 2) {
+		return;
+	}
+	int s = m_segment.at(v);
+	int p = prevSegment(s);
+	if (m_segments.at(p).vertices.size() + m_segments.at(s).vertices.size() <= m_groupSize) {
+		merge(p, s);
+		if (m_order.size() < 2) {
+			return;
+		}
+		s = p;
+	}
+	int n = nextSegment(s);
+	if (m_segments.at(s).vertices.size() + m_segments.at(n).vertices.size() <= m_groupSize) {
+		merge(s, n);
+	}
+}
+
+// Appends segment t, which follows s, to s
+void TwoLevelList::merge(int s, int t)
+{
+	Segment &segment = m_segments[s];
+	if (segment.reversed) {
+		QVector<int> &vertices = segment.vertices;
+		for (int i = 0, j = vertices.size() - 1; i < j; ++i, --j) {
+			qSwap(vertices[i], vertices[j]);
+		}
+		segment.reversed = false;
+		reindex(s);
+	}
+	const Segment &tail = m_segments.at(t);
+	int size = tail.vertices.size();
+	for (int i = 0; i < size; ++i) {
+		int v = tail.vertices.at(tail.reversed ? size - 1 - i : i);
+		m_segment[v] = s;
+		m_index[v] = segment.vertices.size();
+		segment.vertices.append(v);
+	}
+	removeSegment(t);
+}
+
+void TwoLevelList::insertSegment(int rank, int s)
+{
+	m_order.insert(rank, s);
+	for (int i = rank; i < m_order.size(); ++i) {
+		m_segments[m_order.at(i)].rank = i;
+	}
+}
+
+void TwoLevelList::removeSegment(int s)
+{
+	int rank = m_segments.at(s).rank;
+	m_order.remove(rank);
+	for (int i = rank; i < m_order.size(); ++i) {
+		m_segments[m_order.at(i)].rank = i;
+	}
+	m_segments[s].vertices.clear();
+	m_freeSegments.append(s);
+}
+
+void TwoLevelList::reindex(int s)
+{
+	const QVector<int> &vertices = m_segments.at(s).vertices;
+	for (int i = 0; i < vertices.size(); ++i) {
+		m_segment[vertices.at(i)] = s;
+		m_index[vertices.at(i)] = i;
+	}
+}
+
+} // namespace GIS
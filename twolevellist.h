@@ -0,0 +1,65 @@
+#ifndef TWOLEVELLIST_H
+#define TWOLEVELLIST_H
+
+#include <QVector>
+
+namespace GIS {
+
+// Closed tour split into about sqrt(n) segments, each with its own
+// orientation bit (Fredman et al.). The segments are kept in an ordered
+// array, so next() and prev() are O(1) and reversing a path of any length
+// costs O(sqrt n): the segments at its ends are split, the run of whole
+// segments between them is reversed in the array and their bits flipped,
+// then small neighbours are merged again.
+class TwoLevelList
+{
+public:
+	TwoLevelList();
+
+	// Sequence of the vertices 0 .. n - 1
+	void setTour(const QVector<int> &tour);
+	int size() const { return m_n; }
+
+	int next(int v) const;
+	int prev(int v) const;
+
+	// Reverses the path from..to (following next()), or the rest of the tour
+	// if that one is shorter - both give the same cyclic tour
+	void reverse(int from, int to);
+
+	// The tour as a sequence starting at the given vertex
+	QVector<int> tour(int start = 0) const;
+
+private:
+	struct Segment {
+		// in the segment's own order, the tour order if not reversed
+		QVector<int> vertices;
+		bool reversed;
+		// position in m_order
+		int rank;
+	};
+
+	int first(int s) const;
+	int nextSegment(int s) const;
+	int prevSegment(int s) const;
+	void splitBefore(int v);
+	void mergeAround(int v);
+	void merge(int s, int t);
+	void insertSegment(int rank, int s);
+	void removeSegment(int s);
+	void reindex(int s);
+
+	int m_n;
+	int m_groupSize;
+	QVector<Segment> m_segments;
+	QVector<int> m_freeSegments;
+	// the segments in tour order
+	QVector<int> m_order;
+	// segment of every vertex and its index in Segment::vertices
+	QVector<int> m_segment;
+	QVector<int> m_index;
+};
+
+} // namespace GIS
+
+#endif // TWOLEVELLIST_H